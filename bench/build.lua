@@ -0,0 +1,26 @@
+
+local S, G, P = precore.helpers()
+
+-- Benches are built with make_test() from test/build.lua, which is
+-- imported first; each also links the shared bench helpers
+function make_benches(group, benches)
+	for name, bench in pairs(benches) do
+		make_test(group, name, bench[0], bench[1])
+		files {
+			G"${BEARD_ROOT}/bench/common/common.cpp"
+		}
+	end
+end
+
+precore.make_solution(
+	"bench",
+	{"debug", "release"},
+	{"x64", "x32"},
+	nil,
+	{
+		"precore.generic",
+	}
+)
+
+precore.import("tty")
+precore.import("txt")
@@ -0,0 +1,67 @@
+
+#include "./common.hpp"
+
+#include <cstdlib>
+#include <new>
+#include <iostream>
+
+namespace {
+static std::size_t s_alloc_count{0u};
+} // anonymous namespace
+
+void*
+operator new(
+	std::size_t size
+) {
+	++s_alloc_count;
+	void* const p = std::malloc(0u != size ? size : 1u);
+	if (nullptr == p) {
+		throw std::bad_alloc{};
+	}
+	return p;
+}
+
+void
+operator delete(
+	void* p
+) noexcept {
+	std::free(p);
+}
+
+void
+operator delete(
+	void* p,
+	std::size_t /*size*/
+) noexcept {
+	std::free(p);
+}
+
+std::size_t
+alloc_count() noexcept {
+	return s_alloc_count;
+}
+
+void
+report_error(
+	Beard::Error const& e
+) {
+	std::cerr
+		<< '[' << Beard::get_error_name(e.code()) << ']'
+		<< '\n' << e.message()
+		<< '\n'
+	<< std::endl;
+}
+
+bool
+load_term_info(
+	Beard::tty::TerminalInfo& term_info,
+	Beard::String const& path
+) {
+	try {
+		term_info.load(path);
+	} catch (Beard::Error const& ex) {
+		report_error(ex);
+		return false;
+	}
+	return true;
+}
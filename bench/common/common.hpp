@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Beard/String.hpp>
+#include <Beard/Error.hpp>
+#include <Beard/tty/TerminalInfo.hpp>
+
+#include <chrono>
+#include <cstddef>
+
+// Number of allocations made through the global operator new, which
+// is replaced in common.cpp
+std::size_t
+alloc_count() noexcept;
+
+struct BenchClock final {
+	using clock = std::chrono::steady_clock;
+
+	clock::time_point start{};
+	std::size_t alloc_start{0u};
+
+	void
+	begin() noexcept {
+		alloc_start = alloc_count();
+		start = clock::now();
+	}
+
+	// Returns elapsed nanoseconds
+	double
+	end() noexcept {
+		auto const elapsed = clock::now() - start;
+		return static_cast<double>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(
+				elapsed
+			).count()
+		);
+	}
+
+	std::size_t
+	allocs() const noexcept {
+		return alloc_count() - alloc_start;
+	}
+};
+
+void
+report_error(
+	Beard::Error const& e
+);
+
+bool
+load_term_info(
+	Beard::tty::TerminalInfo& term_info,
+	Beard::String const& path
+);
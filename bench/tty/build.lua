@@ -0,0 +1,7 @@
+
+make_benches(
+	"tty", {
+	["render"] = {nil, nil},
+	["diff"] = {nil, nil},
+	["cells"] = {nil, nil},
+})
@@ -0,0 +1,240 @@
+// usage: cells [rounds]
+// Compares the packed cell layout (array of structures) against a
+// glyph plane + attribute plane layout (structure of arrays) on a
+// 400x120 buffer for the operations the terminal performs per frame:
+// diffing, filling, attribute-only updates and copying.
+
+#include <Beard/config.hpp>
+#include <Beard/utility.hpp>
+#include <Beard/txt/Defs.hpp>
+#include <Beard/tty/Defs.hpp>
+#include <Beard/tty/Diff.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+
+#include "../common/common.hpp"
+
+using namespace Beard;
+
+namespace {
+
+enum : std::size_t {
+	buffer_width = 400u,
+	buffer_height = 120u,
+	buffer_cells = buffer_width * buffer_height,
+};
+
+struct AoS final {
+	std::vector<tty::Cell> cells;
+
+	AoS()
+		: cells(buffer_cells, tty::s_cell_default)
+	{}
+
+	std::size_t
+	diff(
+		AoS const& other
+	) const noexcept {
+		auto const& kernel = tty::diff_kernel();
+		std::size_t count = 0u;
+		for (std::size_t row = 0u; buffer_height > row; ++row) {
+			auto const x = cells.data() + row * buffer_width;
+			auto const y = other.cells.data() + row * buffer_width;
+			std::size_t index = 0u;
+			for (;;) {
+				index += kernel.find_differ(x + index, y + index, buffer_width - index);
+				if (buffer_width == index) {
+					break;
+				}
+				std::size_t const run_end
+					= index + kernel.find_equal(x + index, y + index, buffer_width - index);
+				count += run_end - index;
+				index = run_end;
+			}
+		}
+		return count;
+	}
+
+	void
+	fill(
+		tty::Cell const& cell
+	) noexcept {
+		std::fill(cells.begin(), cells.end(), cell);
+	}
+
+	void
+	set_bg(
+		tty::attr_type const attr_bg
+	) noexcept {
+		for (auto& cell : cells) {
+			cell.attr_bg = attr_bg;
+		}
+	}
+
+	void
+	copy(
+		AoS const& other
+	) noexcept {
+		std::memcpy(cells.data(), other.cells.data(), buffer_cells * sizeof(tty::Cell));
+	}
+};
+
+struct SoA final {
+	std::vector<std::uint32_t> glyphs;
+	std::vector<std::uint64_t> attrs;
+
+	static std::uint32_t
+	glyph(
+		tty::Cell const& cell
+	) noexcept {
+		std::uint32_t value;
+		std::memcpy(&value, cell.u8block.units, sizeof(value));
+		return value;
+	}
+
+	static std::uint64_t
+	attr(
+		tty::Cell const& cell
+	) noexcept {
+		return
+			static_cast<std::uint64_t>(cell.attr_fg) |
+			(static_cast<std::uint64_t>(cell.attr_bg) << 32u)
+		;
+	}
+
+	SoA()
+		: glyphs(buffer_cells, glyph(tty::s_cell_default))
+		, attrs(buffer_cells, attr(tty::s_cell_default))
+	{}
+
+	std::size_t
+	diff(
+		SoA const& other
+	) const noexcept {
+		std::size_t count = 0u;
+		for (std::size_t index = 0u; buffer_cells > index; ++index) {
+			count += static_cast<std::size_t>(
+				(glyphs[index] != other.glyphs[index]) |
+				(attrs[index] != other.attrs[index])
+			);
+		}
+		return count;
+	}
+
+	void
+	fill(
+		tty::Cell const& cell
+	) noexcept {
+		std::fill(glyphs.begin(), glyphs.end(), glyph(cell));
+		std::fill(attrs.begin(), attrs.end(), attr(cell));
+	}
+
+	void
+	set_bg(
+		tty::attr_type const attr_bg
+	) noexcept {
+		for (auto& value : attrs) {
+			value
+				= (value & 0xFFFFFFFFu)
+				| (static_cast<std::uint64_t>(attr_bg) << 32u)
+			;
+		}
+	}
+
+	void
+	copy(
+		SoA const& other
+	) noexcept {
+		std::memcpy(glyphs.data(), other.glyphs.data(), buffer_cells * sizeof(std::uint32_t));
+		std::memcpy(attrs.data(), other.attrs.data(), buffer_cells * sizeof(std::uint64_t));
+	}
+};
+
+template<class B>
+double
+measure(
+	unsigned const rounds,
+	std::size_t& sink,
+	char const op
+) {
+	B front{};
+	B back{};
+	tty::Cell const cells[]{
+		tty::make_cell('a', tty::Color::red),
+		tty::make_cell('b', tty::Color::green, tty::Color::blue),
+	};
+	BenchClock clock{};
+	clock.begin();
+	for (unsigned round = 0u; rounds > round; ++round) {
+		switch (op) {
+		case 'd': sink += front.diff(back); break;
+		case 'f': back.fill(cells[round & 1u]); break;
+		case 'a': back.set_bg(static_cast<tty::attr_type>(round & 7u)); break;
+		case 'c': front.copy(back); break;
+		}
+	}
+	double const ns = clock.end();
+	sink += front.diff(back);
+	return ns / (static_cast<double>(buffer_cells) * rounds);
+}
+
+} // anonymous namespace
+
+signed
+main(
+	signed argc,
+	char* argv[]
+) {
+	if (2 < argc) {
+		std::cerr <<
+			"invalid arguments\n"
+			"usage: cells [rounds]\n"
+		;
+		return -1;
+	}
+
+	unsigned rounds = 200u;
+	if (1 < argc) {
+		rounds = static_cast<unsigned>(std::atoi(argv[1]));
+		rounds = (0u == rounds) ? 1u : rounds;
+	}
+
+	static struct {
+		char op;
+		char const* name;
+	} const s_ops[]{
+		{'d', "diff"},
+		{'f', "fill"},
+		{'a', "set-bg"},
+		{'c', "copy"},
+	};
+
+	std::size_t sink = 0u;
+	std::cout
+		<< buffer_width << 'x' << buffer_height
+		<< ", sizeof(tty::Cell) = " << sizeof(tty::Cell) << '\n'
+		<< std::left << std::setw(10) << "op"
+		<< std::right << std::setw(12) << "aos"
+		<< std::setw(12) << "soa"
+		<< "  (ns/cell)\n"
+	;
+	for (auto const& op : s_ops) {
+		double const aos = measure<AoS>(rounds, sink, op.op);
+		double const soa = measure<SoA>(rounds, sink, op.op);
+		std::cout
+			<< std::left << std::setw(10) << op.name
+			<< std::right << std::fixed << std::setprecision(3)
+			<< std::setw(12) << aos
+			<< std::setw(12) << soa
+			<< '\n'
+		;
+	}
+	std::cout << "(" << sink % 2u << ")\n";
+	return 0;
+}
@@ -0,0 +1,184 @@
+// usage: diff [rounds]
+// Compares the diff kernels supported by the CPU against each other
+// on wide rows, walking each row the same way present() does, and
+// times their fill functions. Fails if a kernel finds different runs
+// than the scalar kernel or fills incorrectly.
+
+#include <Beard/config.hpp>
+#include <Beard/utility.hpp>
+#include <Beard/tty/Defs.hpp>
+#include <Beard/tty/Diff.hpp>
+
+#include <cstdlib>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+
+#include "../common/common.hpp"
+
+using namespace Beard;
+
+namespace {
+
+struct Pattern final {
+	char const* name;
+	// Whether cell index differs
+	bool (*differs)(std::size_t);
+};
+
+static Pattern const
+s_patterns[]{
+	{"equal", [](std::size_t) { return false; }},
+	{"sparse", [](std::size_t i) { return 0u == (i * 37u) % 211u; }},
+	{"runs", [](std::size_t i) { return 0u != (i / 16u) % 2u; }},
+	{"all", [](std::size_t) { return true; }},
+};
+
+static std::size_t const
+s_widths[]{80u, 400u, 2000u};
+
+// Walk a row like present() does; returns a checksum of the runs
+std::size_t
+walk(
+	tty::DiffKernel const& kernel,
+	tty::Cell const* const x,
+	tty::Cell const* const y,
+	std::size_t const count
+) {
+	std::size_t sum = 0u;
+	std::size_t index = 0u;
+	for (;;) {
+		index += kernel.find_differ(x + index, y + index, count - index);
+		if (count == index) {
+			break;
+		}
+		std::size_t const run_end
+			= index + kernel.find_equal(x + index, y + index, count - index);
+		sum = sum * 31u + index * 7u + run_end;
+		index = run_end;
+	}
+	return sum;
+}
+
+} // anonymous namespace
+
+signed
+main(
+	signed argc,
+	char* argv[]
+) {
+	if (2 < argc) {
+		std::cerr <<
+			"invalid arguments\n"
+			"usage: diff [rounds]\n"
+		;
+		return -1;
+	}
+
+	unsigned rounds = 20000u;
+	if (1 < argc) {
+		rounds = static_cast<unsigned>(std::atoi(argv[1]));
+		rounds = (0u == rounds) ? 1u : rounds;
+	}
+
+	std::cout
+		<< std::left << std::setw(10) << "pattern"
+		<< std::right << std::setw(8) << "width"
+	;
+	for (unsigned impl = 0u; enum_cast(tty::DiffImpl::COUNT) > impl; ++impl) {
+		std::cout
+			<< std::setw(12)
+			<< tty::diff_kernel(static_cast<tty::DiffImpl>(impl)).name
+		;
+	}
+	std::cout << "  (ns/cell)\n";
+
+	bool mismatch = false;
+	for (auto const& pattern : s_patterns) {
+		for (auto const width : s_widths) {
+			std::vector<tty::Cell> front(width, tty::s_cell_default);
+			std::vector<tty::Cell> back(width, tty::s_cell_default);
+			for (std::size_t i = 0u; width > i; ++i) {
+				if (pattern.differs(i)) {
+					back[i].attr_fg = tty::Color::red;
+				}
+			}
+
+			std::cout
+				<< std::left << std::setw(10) << pattern.name
+				<< std::right << std::setw(8) << width
+			;
+			std::size_t const expected = walk(
+				tty::diff_kernel(tty::DiffImpl::scalar),
+				front.data(), back.data(), width
+			);
+			for (unsigned impl = 0u; enum_cast(tty::DiffImpl::COUNT) > impl; ++impl) {
+				auto const kind = static_cast<tty::DiffImpl>(impl);
+				if (!tty::diff_supported(kind)) {
+					std::cout << std::setw(12) << "-";
+					continue;
+				}
+				auto const& kernel = tty::diff_kernel(kind);
+				std::size_t sum = 0u;
+				BenchClock clock{};
+				clock.begin();
+				for (unsigned round = 0u; rounds > round; ++round) {
+					sum += walk(kernel, front.data(), back.data(), width);
+				}
+				double const ns = clock.end();
+				if (sum != expected * rounds) {
+					mismatch = true;
+				}
+				std::cout
+					<< std::fixed << std::setprecision(3) << std::setw(12)
+					<< (ns / (static_cast<double>(width) * rounds))
+				;
+			}
+			std::cout << '\n';
+		}
+	}
+	for (auto const width : s_widths) {
+		std::vector<tty::Cell> cells(width + 1u, tty::s_cell_default);
+		tty::Cell const fill_cells[]{
+			tty::make_cell('a', tty::Color::red),
+			tty::make_cell('b', tty::Color::green, tty::Color::blue),
+		};
+		std::cout
+			<< std::left << std::setw(10) << "fill"
+			<< std::right << std::setw(8) << width
+		;
+		for (unsigned impl = 0u; enum_cast(tty::DiffImpl::COUNT) > impl; ++impl) {
+			auto const kind = static_cast<tty::DiffImpl>(impl);
+			if (!tty::diff_supported(kind)) {
+				std::cout << std::setw(12) << "-";
+				continue;
+			}
+			auto const& kernel = tty::diff_kernel(kind);
+			BenchClock clock{};
+			clock.begin();
+			for (unsigned round = 0u; rounds > round; ++round) {
+				kernel.fill(cells.data(), width, fill_cells[round & 1u]);
+			}
+			double const ns = clock.end();
+			auto const& last = fill_cells[(rounds - 1u) & 1u];
+			for (std::size_t i = 0u; width > i; ++i) {
+				mismatch = mismatch || last != cells[i];
+			}
+			// Must not store past the range
+			mismatch = mismatch || tty::s_cell_default != cells[width];
+			std::cout
+				<< std::fixed << std::setprecision(3) << std::setw(12)
+				<< (ns / (static_cast<double>(width) * rounds))
+			;
+		}
+		std::cout << '\n';
+	}
+	std::cout
+		<< "selected: " << tty::diff_kernel().name << '\n'
+	;
+	if (mismatch) {
+		std::cerr << "kernel results differ from scalar\n";
+		return 1;
+	}
+	return 0;
+}
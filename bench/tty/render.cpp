@@ -0,0 +1,346 @@
+// usage: render terminfo-file-path [frames]
+// Drives a headless terminal through typical render workloads and
+// reports time per cell, bytes emitted per frame and heap
+// allocations per frame. Fails if present() allocates in steady
+// state.
+
+#include <Beard/config.hpp>
+#include <Beard/String.hpp>
+#include <Beard/utility.hpp>
+#include <Beard/Error.hpp>
+#include <Beard/geometry.hpp>
+#include <Beard/txt/Defs.hpp>
+#include <Beard/tty/Defs.hpp>
+#include <Beard/tty/TerminalInfo.hpp>
+#include <Beard/tty/Terminal.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+
+#include "../common/common.hpp"
+
+using namespace Beard;
+
+namespace {
+
+enum : unsigned {
+	warmup_frames = 8u,
+	corpus_lines = 512u,
+};
+
+static tty::attr_type const
+s_colors[]{
+	tty::Color::red,
+	tty::Color::green,
+	tty::Color::yellow,
+	tty::Color::blue,
+	tty::Color::magenta,
+	tty::Color::cyan,
+	tty::Color::white,
+	tty::Color::term_default,
+};
+
+struct Corpus final {
+	String data{};
+	std::size_t line_size{0u};
+
+	void
+	build(
+		std::size_t const width
+	) {
+		static char const s_words[]{
+			"lorem ipsum dolor sit amet consectetur adipiscing elit "
+			"sed do eiusmod tempor incididunt ut labore et dolore "
+		};
+		line_size = width;
+		data.clear();
+		data.reserve(corpus_lines * line_size);
+		for (unsigned line = 0u; corpus_lines > line; ++line) {
+			String head{std::to_string(line)};
+			head.append(": ");
+			for (std::size_t i = 0u; line_size > i; ++i) {
+				data.push_back(
+					i < head.size()
+					? head[i]
+					: s_words[(i + line * 7u) % (sizeof(s_words) - 1u)]
+				);
+			}
+		}
+	}
+
+	txt::Sequence
+	line(
+		unsigned const index
+	) const noexcept {
+		return {
+			data.data() + (index % corpus_lines) * line_size,
+			line_size
+		};
+	}
+};
+
+struct Workload final {
+	char const* name;
+	void (*frame)(tty::Terminal&, Corpus const&, unsigned);
+};
+
+// Every cell changes every frame
+void
+frame_full(
+	tty::Terminal& term,
+	Corpus const& corpus,
+	unsigned const frame
+) {
+	term.clear_back(Rect{{0, 0}, term.size()});
+	for (geom_value_type y = 0; term.height() > y; ++y) {
+		auto const seq = corpus.line(frame + unsigned_cast(y));
+		for (geom_value_type x = 0; term.width() > x; x += 10) {
+			term.put_sequence(
+				x, y,
+				{seq.data + x, seq.size - unsigned_cast(x)},
+				10u,
+				s_colors[(unsigned_cast(x / 10) + frame) % 8u],
+				s_colors[(unsigned_cast(y) + frame) % 8u]
+			);
+		}
+	}
+}
+
+// Log view scrolling by one line per frame
+void
+frame_scroll(
+	tty::Terminal& term,
+	Corpus const& corpus,
+	unsigned const frame
+) {
+	for (geom_value_type y = 0; term.height() > y; ++y) {
+		term.put_sequence(
+			0, y,
+			corpus.line(frame + unsigned_cast(y)),
+			unsigned_cast(term.width())
+		);
+	}
+}
+
+// Same log view, scrolled with scroll_region() so that only the new
+// line is drawn
+void
+frame_scroll_region(
+	tty::Terminal& term,
+	Corpus const& corpus,
+	unsigned const frame
+) {
+	geom_value_type const last = term.height() - 1;
+	term.scroll_region(Rect{{0, 0}, term.size()}, 1);
+	term.put_sequence(
+		0, last,
+		corpus.line(frame + unsigned_cast(last)),
+		unsigned_cast(term.width())
+	);
+}
+
+// A handful of single-cell updates
+void
+frame_sparse(
+	tty::Terminal& term,
+	Corpus const& /*corpus*/,
+	unsigned const frame
+) {
+	std::uint32_t seed = 0x9E3779B9u * (frame + 1u);
+	for (unsigned i = 0u; 16u > i; ++i) {
+		seed = seed * 1664525u + 1013904223u;
+		auto const x = static_cast<geom_value_type>(
+			(seed >> 8u) % unsigned_cast(term.width())
+		);
+		auto const y = static_cast<geom_value_type>(
+			(seed >> 20u) % unsigned_cast(term.height())
+		);
+		term.put_cell(x, y, tty::make_cell(
+			static_cast<char>('a' + (seed % 26u)),
+			s_colors[seed % 8u]
+		));
+	}
+}
+
+// Widget-style frame: panels are cleared and redrawn, but only a
+// status line actually changes
+void
+frame_widgets(
+	tty::Terminal& term,
+	Corpus const& corpus,
+	unsigned const frame
+) {
+	geom_value_type const
+		half = term.width() / 2,
+		body = term.height() - 1
+	;
+	Rect const panels[]{
+		{{0, 0}, {half, body}},
+		{{half, 0}, {term.width() - half, body}},
+	};
+	for (auto const& panel : panels) {
+		term.clear_back(panel);
+		term.put_rect(
+			panel, tty::s_frame_single,
+			tty::Color::blue
+		);
+		term.put_line(
+			{panel.pos.x + 1, panel.pos.y + 2},
+			panel.size.width - 2,
+			Axis::horizontal,
+			tty::make_cell(U'─', tty::Color::blue)
+		);
+		term.put_sequence(
+			panel.pos.x + 2, panel.pos.y + 1,
+			corpus.line(0u),
+			unsigned_cast(panel.size.width - 4)
+		);
+	}
+	term.clear_back(Rect{{0, body}, {term.width(), 1}});
+	term.put_sequence(
+		0, body,
+		corpus.line(frame),
+		unsigned_cast(term.width()),
+		tty::Color::term_default | tty::Attr::bold,
+		tty::Color::term_default | tty::Attr::inverted
+	);
+}
+
+static Workload const
+s_workloads[]{
+	{"full-redraw", frame_full},
+	{"scrolling-log", frame_scroll},
+	{"scroll-region", frame_scroll_region},
+	{"sparse-cells", frame_sparse},
+	{"widgets", frame_widgets},
+};
+
+static Vec2 const
+s_sizes[]{
+	{200, 60},
+	{400, 120},
+};
+
+// Returns the number of heap allocations made by present() after
+// warmup
+std::size_t
+run(
+	tty::Terminal& term,
+	Workload const& workload,
+	Vec2 const& size,
+	unsigned const frames
+) {
+	Corpus corpus{};
+	corpus.build(unsigned_cast(size.width));
+
+	term.set_headless_size(size);
+	tty::Event event{};
+	term.poll(event, 0u);
+	term.clear_front(true);
+
+	for (unsigned frame = 0u; warmup_frames > frame; ++frame) {
+		workload.frame(term, corpus, frame);
+		term.present();
+	}
+	term.clear_headless_output();
+
+	double ns = 0.0;
+	std::size_t bytes = 0u;
+	std::size_t allocs = 0u;
+	std::size_t present_allocs = 0u;
+	BenchClock clock{};
+	for (unsigned frame = 0u; frames > frame; ++frame) {
+		clock.begin();
+		workload.frame(term, corpus, warmup_frames + frame);
+		std::size_t const frame_allocs = alloc_count();
+		term.present();
+		present_allocs += alloc_count() - frame_allocs;
+		ns += clock.end();
+		allocs += clock.allocs();
+		bytes += term.headless_output().size();
+		term.clear_headless_output();
+	}
+
+	double const cells
+		= static_cast<double>(size.width * size.height)
+		* static_cast<double>(frames)
+	;
+	std::cout
+		<< std::left << std::setw(16) << workload.name
+		<< std::right
+		<< std::setw(5) << size.width << 'x'
+		<< std::left << std::setw(5) << size.height
+		<< std::right << std::fixed << std::setprecision(3)
+		<< std::setw(12) << (ns / cells)
+		<< std::setw(14) << (ns / frames / 1000.0)
+		<< std::setw(14) << std::setprecision(1)
+		<< (static_cast<double>(bytes) / frames)
+		<< std::setw(14) << std::setprecision(2)
+		<< (static_cast<double>(allocs) / frames)
+		<< '\n'
+	;
+	return present_allocs;
+}
+
+} // anonymous namespace
+
+signed
+main(
+	signed argc,
+	char* argv[]
+) {
+	if (2 > argc || 3 < argc) {
+		std::cerr <<
+			"invalid arguments\n"
+			"usage: render terminfo-file-path [frames]\n"
+		;
+		return -1;
+	}
+
+	unsigned frames = 200u;
+	if (2 < argc) {
+		frames = static_cast<unsigned>(std::atoi(argv[2]));
+		frames = (0u == frames) ? 1u : frames;
+	}
+
+	tty::Terminal term{};
+	if (!load_term_info(term.info(), argv[1])) {
+		return -2;
+	}
+	term.update_cache();
+
+	try {
+		term.open_headless(s_sizes[0u]);
+	} catch (Error& ex) {
+		report_error(ex);
+		return -3;
+	}
+
+	std::cout
+		<< std::left << std::setw(16) << "workload"
+		<< std::setw(11) << "size"
+		<< std::right
+		<< std::setw(12) << "ns/cell"
+		<< std::setw(14) << "us/frame"
+		<< std::setw(14) << "bytes/frame"
+		<< std::setw(14) << "allocs/frame"
+		<< '\n'
+	;
+	std::size_t present_allocs = 0u;
+	for (auto const& size : s_sizes) {
+		for (auto const& workload : s_workloads) {
+			present_allocs += run(term, workload, size, frames);
+		}
+	}
+	term.close();
+	if (0u != present_allocs) {
+		std::cerr
+			<< "present() made " << present_allocs
+			<< " heap allocations in steady state\n"
+		;
+		return 1;
+	}
+	return 0;
+}
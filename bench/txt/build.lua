@@ -0,0 +1,5 @@
+
+make_benches(
+	"txt", {
+	["utf8"] = {nil, nil},
+})
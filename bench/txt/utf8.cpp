@@ -0,0 +1,226 @@
+// usage: utf8 [rounds]
+// Compares the UTF-8 kernels supported by the CPU against each other
+// and against stepping through lead units with EncUtils on ASCII,
+// mixed Latin and CJK text, and times txt::Tree construction. Fails
+// if a kernel's results differ from the scalar kernel's.
+
+#include <Beard/config.hpp>
+#include <Beard/String.hpp>
+#include <Beard/utility.hpp>
+#include <Beard/txt/Defs.hpp>
+#include <Beard/txt/UTF8.hpp>
+#include <Beard/txt/Tree.hpp>
+
+#include <cstdlib>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+#include "../common/common.hpp"
+
+using namespace Beard;
+
+namespace {
+
+enum : std::size_t {
+	corpus_size = 1u << 20u,
+	line_points = 80u,
+};
+
+struct Corpus final {
+	char const* name;
+	// Space-separated words
+	char const* words;
+	String data;
+};
+
+static Corpus
+s_corpora[]{
+	{
+		"ascii",
+		"the quick brown fox jumps over the lazy dog while "
+		"lorem ipsum dolor sit amet consectetur adipiscing elit ",
+		{}
+	},
+	{
+		"latin",
+		"le cœur déçu mais voilà l'été où naïve Zoë "
+		"schließlich über größere Bäume für Müller "
+		"el niño pidió café y jalapeño ",
+		{}
+	},
+	{
+		"cjk",
+		"快速的棕色狐狸跳过了懒狗。 日本語の文章を表示します。 "
+		"한국어 텍스트도 포함됩니다 ",
+		{}
+	},
+};
+
+void
+build(
+	Corpus& corpus
+) {
+	String const words{corpus.words};
+	corpus.data.clear();
+	corpus.data.reserve(corpus_size + 2u * words.size());
+	std::size_t points = 0u;
+	while (corpus_size > corpus.data.size()) {
+		for (auto it = words.cbegin(); words.cend() != it;) {
+			auto const size = txt::EncUtils::required_first_whole(*it);
+			corpus.data.append(it, it + size);
+			it += size;
+			if (line_points == ++points) {
+				corpus.data.push_back('\n');
+				points = 0u;
+			}
+		}
+	}
+}
+
+// Count code points the way txt used to
+std::size_t
+step_count(
+	char const* const data,
+	std::size_t const size
+) {
+	std::size_t count = 0u;
+	for (
+		auto it = data, end = data + size;
+		end > it;
+		it += txt::EncUtils::required_first_whole(*it)
+	) {
+		++count;
+	}
+	return count;
+}
+
+template<class F>
+double
+time_gbps(
+	unsigned const rounds,
+	std::size_t const size,
+	std::size_t& sum,
+	F const f
+) {
+	BenchClock clock{};
+	clock.begin();
+	for (unsigned round = 0u; rounds > round; ++round) {
+		sum += f();
+	}
+	double const ns = clock.end();
+	return static_cast<double>(size) * rounds / ns;
+}
+
+} // anonymous namespace
+
+signed
+main(
+	signed argc,
+	char* argv[]
+) {
+	if (2 < argc) {
+		std::cerr <<
+			"invalid arguments\n"
+			"usage: utf8 [rounds]\n"
+		;
+		return -1;
+	}
+
+	unsigned rounds = 200u;
+	if (1 < argc) {
+		rounds = static_cast<unsigned>(std::atoi(argv[1]));
+		rounds = (0u == rounds) ? 1u : rounds;
+	}
+
+	std::cout
+		<< std::left << std::setw(8) << "corpus"
+		<< std::setw(8) << "op"
+		<< std::right << std::setw(10) << "step"
+	;
+	for (unsigned impl = 0u; enum_cast(txt::UTF8Impl::COUNT) > impl; ++impl) {
+		std::cout
+			<< std::setw(10)
+			<< txt::utf8_kernel(static_cast<txt::UTF8Impl>(impl)).name
+		;
+	}
+	std::cout << "  (GB/s)\n";
+
+	bool mismatch = false;
+	for (auto& corpus : s_corpora) {
+		build(corpus);
+		auto const data = corpus.data.data();
+		auto const size = corpus.data.size();
+		auto const& scalar = txt::utf8_kernel(txt::UTF8Impl::scalar);
+		std::size_t const expected[]{
+			scalar.valid_prefix(data, size),
+			scalar.count_points(data, size),
+		};
+		mismatch = mismatch || size != expected[0u];
+		for (unsigned op = 0u; 2u > op; ++op) {
+			std::cout
+				<< std::left << std::setw(8) << corpus.name
+				<< std::setw(8) << (0u == op ? "valid" : "count")
+				<< std::right << std::fixed << std::setprecision(2)
+			;
+			if (0u == op) {
+				// EncUtils doesn't validate
+				std::cout << std::setw(10) << "-";
+			} else {
+				std::size_t sum = 0u;
+				std::cout << std::setw(10) << time_gbps(rounds, size, sum, [&]() {
+					return step_count(data, size);
+				});
+				mismatch = mismatch || sum != expected[op] * rounds;
+			}
+			for (unsigned impl = 0u; enum_cast(txt::UTF8Impl::COUNT) > impl; ++impl) {
+				auto const kind = static_cast<txt::UTF8Impl>(impl);
+				if (!txt::utf8_supported(kind)) {
+					std::cout << std::setw(10) << "-";
+					continue;
+				}
+				auto const& kernel = txt::utf8_kernel(kind);
+				auto const func
+					= 0u == op ? kernel.valid_prefix : kernel.count_points;
+				std::size_t sum = 0u;
+				std::cout << std::setw(10) << time_gbps(rounds, size, sum, [&]() {
+					return func(data, size);
+				});
+				mismatch = mismatch || sum != expected[op] * rounds;
+			}
+			std::cout << '\n';
+		}
+	}
+
+	std::cout << "\ntxt::Tree construction (" << txt::utf8_kernel().name << ")\n";
+	for (auto const& corpus : s_corpora) {
+		unsigned const tree_rounds = max_ce(rounds / 20u, 1u);
+		std::size_t sum = 0u;
+		double const gbps = time_gbps(
+			tree_rounds, corpus.data.size(), sum, [&]() {
+				return txt::Tree{corpus.data}.points();
+			}
+		);
+		std::cout
+			<< std::left << std::setw(8) << corpus.name
+			<< std::right << std::fixed << std::setprecision(2)
+			<< std::setw(10) << gbps << " GB/s\n"
+		;
+		// Line breaks aren't counted
+		std::size_t const points
+			= step_count(corpus.data.data(), corpus.data.size())
+			- unsigned_cast(std::count(
+				corpus.data.cbegin(), corpus.data.cend(), '\n'
+			))
+		;
+		mismatch = mismatch || sum != points * tree_rounds;
+	}
+	std::cout
+		<< "selected: " << txt::utf8_kernel().name << '\n'
+	;
+	if (mismatch) {
+		std::cerr << "kernel results differ from scalar\n";
+		return 1;
+	}
+	return 0;
+}
@@ -10,6 +10,9 @@
 #include <Beard/config.hpp>
 #include <Beard/String.hpp>
 
+#include <cstddef>
+#include <cstring>
+
 namespace Beard {
 namespace tty {
 
@@ -43,9 +46,38 @@ using CapNumberValue = signed;
 /**
 	CapString value.
 
+	@note This refers to the storage of the tty::TerminalInfo it was
+	fetched from, and is invalidated when that is modified or
+	destroyed.
+
 	@sa tty::TerminalInfo
 */
-using CapStringValue = String;
+struct CapStringValue final {
+	/** NUL-terminated units. */
+	char const* data{nullptr};
+	/** Number of units, excluding the terminator. */
+	std::size_t size{0u};
+
+	/**
+		Check if the value is empty.
+	*/
+	bool
+	empty() const noexcept {
+		return 0u == size;
+	}
+
+	/**
+		Check if the value is equal to a C-string.
+
+		@param str C-string to compare with.
+	*/
+	bool
+	equals(
+		char const* const str
+	) const noexcept {
+		return nullptr != data && 0 == std::strcmp(data, str);
+	}
+};
 
 /**
 	Various capability constants.
@@ -12,6 +12,9 @@
 #include <Beard/geometry.hpp>
 #include <Beard/txt/Defs.hpp>
 
+#include <cstring>
+#include <type_traits>
+
 namespace Beard {
 namespace tty {
 
@@ -40,8 +43,14 @@ enum : tty::fd_type {
 
 /**
 	Color + attribute type.
+
+	@note The low 24 bits hold the color value, the next 4 bits hold
+	tty::Attr flags and the 2 bits above them hold the color kind.
+
+	@sa tty::Attr,
+		tty::Color
 */
-using attr_type = std::uint16_t;
+using attr_type = std::uint32_t;
 
 /**
 	%Attributes.
@@ -49,16 +58,22 @@ using attr_type = std::uint16_t;
 namespace Attr {
 enum enum_type : tty::attr_type {
 	none		= 0,
-	bold		= 0x0100,
-	underline	= 0x0200,
-	inverted	= 0x0400,
-	blink		= 0x0800,
-	mask		= 0x0F00,
+	bold		= 0x01000000,
+	underline	= 0x02000000,
+	inverted	= 0x04000000,
+	blink		= 0x08000000,
+	mask		= 0x0F000000,
 };
 }
 
 /**
 	%Colors.
+
+	@note Colors that the terminal can't display are reduced to the
+	nearest color it can display when written.
+
+	@sa tty::make_color_index(),
+		tty::make_color_rgb()
 */
 namespace Color {
 enum enum_type : tty::attr_type {
@@ -75,13 +90,64 @@ enum enum_type : tty::attr_type {
 	magenta			= 0x06,
 	cyan			= 0x07,
 	white			= 0x08,
-	// TODO: What is the canonical 38/48?
+
+	/** Color value: basic color, palette index or 0xRRGGBB. */
+	mask_value		= 0x00FFFFFF,
+	/** Color kind: 256-color palette index. */
+	kind_index		= 0x10000000,
+	/** Color kind: 24-bit RGB. */
+	kind_rgb		= 0x20000000,
+	/** Color kind. */
+	mask_kind		= 0x30000000,
+	/** Color value and kind. */
+	mask			= mask_kind | mask_value,
 };
 }
 
+/**
+	Construct a 256-color palette color.
+
+	@note Indices 0 through 15 are the basic and bright colors,
+	16 through 231 are a 6x6x6 color cube and 232 through 255 are a
+	grayscale ramp.
+
+	@param index Palette index.
+*/
+inline constexpr tty::attr_type
+make_color_index(
+	unsigned const index
+) noexcept {
+	return tty::Color::kind_index | (index & 0xFFu);
+}
+
+/**
+	Construct a 24-bit RGB color.
+
+	@param r Red component.
+	@param g Green component.
+	@param b Blue component.
+*/
+inline constexpr tty::attr_type
+make_color_rgb(
+	unsigned const r,
+	unsigned const g,
+	unsigned const b
+) noexcept {
+	return
+		tty::Color::kind_rgb |
+		((r & 0xFFu) << 16u) |
+		((g & 0xFFu) << 8u) |
+		(b & 0xFFu)
+	;
+}
+
 /**
 	%Terminal cell.
 
+	@note Cells are packed into 12 bytes with no padding and are
+	always fully initialised, so they can be compared and copied
+	bytewise.
+
 	@sa tty::Terminal,
 		txt::UTF8Block,
 		tty::Attr,
@@ -99,6 +165,42 @@ struct Cell final {
 /// @}
 };
 
+static_assert(
+	std::is_standard_layout<tty::Cell>::value &&
+	std::is_trivially_copyable<tty::Cell>::value,
+	"tty::Cell must be a trivially-copyable standard-layout type"
+);
+static_assert(
+	12u == sizeof(tty::Cell) &&
+	sizeof(tty::Cell)
+	== sizeof(txt::UTF8Block) + 2u * sizeof(tty::attr_type),
+	"tty::Cell must be packed into 12 bytes"
+);
+
+/** @name Cell comparison */ /// @{
+/**
+	Equal-to operator for Cell.
+*/
+inline bool
+operator==(
+	tty::Cell const& x,
+	tty::Cell const& y
+) noexcept {
+	return 0 == std::memcmp(&x, &y, sizeof(tty::Cell));
+}
+
+/**
+	Not-equal-to operator for Cell.
+*/
+inline bool
+operator!=(
+	tty::Cell const& x,
+	tty::Cell const& y
+) noexcept {
+	return !(x == y);
+}
+/// @}
+
 /**
 	Construct a cell.
 
@@ -119,6 +221,101 @@ make_cell(
 	};
 }
 
+/** @name Wide cells */ /// @{
+
+/**
+	Code unit that marks a continuation cell.
+
+	@note A wide (two-column) cell is followed in the buffers by a
+	continuation cell, whose first code unit is this (it never occurs
+	in UTF-8) and whose attributes are those of the wide cell. The
+	wide cell covers it on screen, so it is never written itself.
+*/
+static constexpr txt::EncUtils::char_type const
+continuation_unit = '\xFF';
+
+/**
+	Construct a continuation cell.
+
+	@param attr_fg Foreground attributes of the wide cell.
+	@param attr_bg Background attributes of the wide cell.
+*/
+inline constexpr tty::Cell
+make_continuation_cell(
+	tty::attr_type attr_fg,
+	tty::attr_type attr_bg
+) noexcept {
+	return tty::Cell{
+		txt::UTF8Block{tty::continuation_unit},
+		attr_fg,
+		attr_bg
+	};
+}
+
+/**
+	Check if a cell is a continuation cell.
+*/
+inline constexpr bool
+is_continuation(
+	tty::Cell const& cell
+) noexcept {
+	return tty::continuation_unit == cell.u8block.units[0u];
+}
+
+/**
+	Code unit that marks a cell whose cluster is stored by a terminal.
+
+	@note A grapheme cluster that doesn't fit in a cell's block is
+	stored by the tty::Terminal it is put on. The block then holds
+	this unit (it never occurs in UTF-8) followed by a reference to
+	the cluster, and the cell is only meaningful to that terminal.
+*/
+static constexpr txt::EncUtils::char_type const
+cluster_ref_unit = '\xFE';
+
+/**
+	Check if a cell refers to a cluster stored by a terminal.
+*/
+inline constexpr bool
+is_cluster_ref(
+	tty::Cell const& cell
+) noexcept {
+	return tty::cluster_ref_unit == cell.u8block.units[0u];
+}
+
+/**
+	Get the number of columns a cell takes.
+
+	@returns 0 for continuation cells, 2 for wide cells and 1
+	otherwise.
+*/
+inline unsigned
+cell_width(
+	tty::Cell const& cell
+) noexcept {
+	auto const lead = static_cast<unsigned char>(cell.u8block.units[0u]);
+	if (0x80u > lead) {
+		return 1u;
+	} else if (tty::is_continuation(cell)) {
+		return 0u;
+	} else if (tty::is_cluster_ref(cell)) {
+		// The reference carries the width
+		return (0x80u & static_cast<unsigned char>(cell.u8block.units[1u]))
+			? 2u
+			: 1u
+		;
+	}
+	char32 cp;
+	txt::EncUtils::decode(
+		cell.u8block.units, std::end(cell.u8block.units),
+		cp, duct::CHAR_REPLACEMENT
+	);
+	// Clusters that lead with a combining mark take a column
+	return 2u == txt::code_point_width(cp) ? 2u : 1u;
+}
+
+/// @}
+
 /** @name Pre-defined cells and frames */ /// @{
 
 static constexpr Cell const
@@ -0,0 +1,126 @@
+/**
+@copyright MIT license; see @ref index or the accompanying LICENSE file.
+
+@file
+@brief %Cell buffer diff and fill kernels.
+*/
+
+#pragma once
+
+#include <Beard/config.hpp>
+#include <Beard/tty/Defs.hpp>
+
+#include <cstddef>
+
+namespace Beard {
+namespace tty {
+
+// Forward declarations
+enum class DiffImpl : unsigned;
+struct DiffKernel;
+
+/**
+	@addtogroup tty
+	@{
+*/
+
+/**
+	%Diff kernel implementations.
+*/
+enum class DiffImpl : unsigned {
+	/** Cell-by-cell comparison. */
+	scalar = 0u,
+	/** SSE2 comparison (x86). */
+	sse2,
+	/** AVX2 comparison (x86). */
+	avx2,
+
+/** @cond INTERNAL */
+	COUNT
+/** @endcond */
+};
+
+/**
+	%Cell range search function.
+
+	@returns Index of the first matching cell in <code>[0, count)</code>,
+	or @a count if there is none.
+	@param x First cell range.
+	@param y Second cell range.
+	@param count Number of cells in each range.
+*/
+using diff_find_func_type = std::size_t (*)(
+	tty::Cell const* x,
+	tty::Cell const* y,
+	std::size_t count
+) noexcept;
+
+/**
+	%Cell range fill function.
+
+	@param dst Destination cell range.
+	@param count Number of cells in @a dst.
+	@param cell Cell to store.
+*/
+using fill_func_type = void (*)(
+	tty::Cell* dst,
+	std::size_t count,
+	tty::Cell const& cell
+) noexcept;
+
+/**
+	%Diff kernel.
+
+	Finds runs of differing cells between two cell ranges and fills
+	cell ranges with a pattern store.
+*/
+struct DiffKernel final {
+/** @name Properties */ /// @{
+	/** Implementation. */
+	tty::DiffImpl impl;
+	/** Name. */
+	char const* name;
+	/** Find the first cell that differs. */
+	tty::diff_find_func_type find_differ;
+	/** Find the first cell that is equal. */
+	tty::diff_find_func_type find_equal;
+	/** Fill a cell range. */
+	tty::fill_func_type fill;
+/// @}
+};
+
+/**
+	Check if a diff kernel implementation is supported by the CPU.
+
+	@param impl Implementation.
+*/
+bool
+diff_supported(
+	tty::DiffImpl const impl
+) noexcept;
+
+/**
+	Get a diff kernel.
+
+	@warning The kernel must be supported by the CPU.
+
+	@param impl Implementation.
+*/
+tty::DiffKernel const&
+diff_kernel(
+	tty::DiffImpl const impl
+) noexcept;
+
+/**
+	Get the fastest diff kernel supported by the CPU.
+
+	@note The kernel is selected by CPU feature detection on the
+	first call.
+*/
+tty::DiffKernel const&
+diff_kernel() noexcept;
+
+/** @} */ // end of doc-group tty
+
+} // namespace tty
+} // namespace Beard
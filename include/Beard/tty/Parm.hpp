@@ -0,0 +1,149 @@
+/**
+@copyright MIT license; see @ref index or the accompanying LICENSE file.
+
+@file
+@brief Parametrized capability strings.
+*/
+
+#pragma once
+
+#include <Beard/config.hpp>
+#include <Beard/aux.hpp>
+#include <Beard/String.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Beard {
+namespace tty {
+
+// Forward declarations
+class ParmProgram;
+
+/**
+	@addtogroup tty
+	@{
+*/
+
+/**
+	Compiled parametrized capability string.
+
+	A capability string such as @c cursor_address is compiled once
+	into a sequence of operations which is evaluated with integer
+	parameters without allocating.
+
+	@note All of the @c % operations in `man 5 terminfo` are
+	supported. Parameters are integers; @c %s formats its operand as
+	@c %d and @c %l pushes 0. Static variables do not persist between
+	evaluations. Delays (<code>$<..></code>) are removed.
+*/
+class ParmProgram final {
+public:
+	/** Parameter type. */
+	using value_type = std::int32_t;
+
+	enum : unsigned {
+		/** Maximum number of parameters. */
+		max_params = 9u,
+		/** Evaluation stack size. */
+		stack_size = 20u,
+	};
+
+private:
+	struct Op final {
+		std::uint8_t code;
+		// Length of text, or format flags
+		std::uint8_t flags;
+		// Text offset, constant index, parameter, variable, jump
+		// target, or format width and precision
+		std::uint16_t arg;
+	};
+	using op_vector_type = aux::vector<Op>;
+
+	op_vector_type m_ops;
+	aux::vector<char> m_text;
+	aux::vector<value_type> m_constants;
+	std::size_t m_max_size;
+
+public:
+/** @name Constructors and destructor */ /// @{
+	/** Destructor. */
+	~ParmProgram() noexcept;
+
+	/** Default constructor. */
+	ParmProgram() noexcept;
+	/** Move constructor. */
+	ParmProgram(ParmProgram&&) noexcept;
+	/** Copy constructor. */
+	ParmProgram(ParmProgram const&);
+/// @}
+
+/** @name Operators */ /// @{
+	/** Move assignment operator. */
+	ParmProgram& operator=(ParmProgram&&) noexcept;
+	/** Copy assignment operator. */
+	ParmProgram& operator=(ParmProgram const&);
+/// @}
+
+/** @name Properties */ /// @{
+	/**
+		Check if the program is empty.
+
+		@note An empty program evaluates to nothing.
+	*/
+	bool
+	empty() const noexcept {
+		return m_ops.empty();
+	}
+
+	/**
+		Get the largest number of units that evaluate() can write.
+	*/
+	std::size_t
+	max_size() const noexcept {
+		return m_max_size;
+	}
+/// @}
+
+/** @name Operations */ /// @{
+	/**
+		Clear the program.
+	*/
+	void
+	clear() noexcept;
+
+	/**
+		Compile a capability string.
+
+		@returns @c true on success, or @c false if @a str is
+		malformed, in which case the program is empty.
+		@param str Capability string.
+	*/
+	bool
+	compile(
+		String const& str
+	);
+
+	/**
+		Evaluate the program.
+
+		@returns The number of units written to @a buffer.
+		@param buffer Output buffer; must have room for max_size()
+		units.
+		@param params Parameters; missing parameters are 0.
+		@param count Number of parameters in @a params; values past
+		max_params are ignored.
+	*/
+	std::size_t
+	evaluate(
+		char* const buffer,
+		value_type const* const params,
+		unsigned const count
+	) const noexcept;
+/// @}
+};
+
+/** @} */ // end of doc-group tty
+
+} // namespace tty
+} // namespace Beard
@@ -16,14 +16,17 @@
 #include <Beard/txt/Defs.hpp>
 #include <Beard/tty/Defs.hpp>
 #include <Beard/tty/TerminalInfo.hpp>
+#include <Beard/tty/Parm.hpp>
 
 #include <duct/cc_unique_ptr.hpp>
 #include <duct/StateStore.hpp>
 #include <duct/IO/dynamic_streambuf.hpp>
 
+#include <memory>
 #include <utility>
+#include <cstdint>
+#include <cstring>
 #include <istream>
-#include <ostream>
 
 namespace Beard {
 namespace tty {
@@ -39,39 +42,6 @@ class Terminal;
 /** @cond INTERNAL */
 namespace {
 
-class moveable_ostream final
-	: public std::basic_ostream<char>
-{
-private:
-	using base = std::basic_ostream<char>;
-
-public:
-	moveable_ostream(
-		std::basic_streambuf<char>& streambuf
-	)
-		: base(&streambuf)
-	{}
-
-	moveable_ostream(
-		moveable_ostream&& other
-	)
-		: base(std::move(other))
-	{
-		this->set_rdbuf(other.rdbuf());
-		other.set_rdbuf(nullptr);
-	}
-
-	moveable_ostream&
-	operator=(
-		moveable_ostream&& other
-	) {
-		base::operator=(std::move(other));
-		this->set_rdbuf(other.rdbuf());
-		other.set_rdbuf(nullptr);
-		return *this;
-	}
-};
-
 class moveable_istream final
 	: public std::basic_istream<char>
 {
@@ -122,13 +92,87 @@ private:
 	enum : unsigned {
 		inbuf_size = 0x80,
 		inbuf_high_mark = 0x60,
-		outbuf_size = 0x800
+		outbuf_size = 0x800,
+		out_reserve_per_cell = 4u,
+		out_pending_max_default = 0x10000,
+		// Minimum number of rows that a detected scroll must save
+		// from being redrawn
+		scroll_detect_min_rows = 2u,
+		// Number of SGR cache entries (power of two)
+		sgr_cache_size = 64u,
+		// Longest cacheable attribute sequence
+		sgr_cache_data_size = 47u,
+		// Number of parametrized cap cache entries (power of two)
+		parm_cache_size = 128u,
+		// Longest cacheable parametrized cap output
+		parm_cache_data_size = 22u,
+		// Largest index of a stored cluster
+		cluster_index_max = 0x7FFFFFu,
+		// Number of stored clusters before unreferenced ones are
+		// first dropped
+		cluster_compact_min = 1024u
 	};
 
 	enum class State : unsigned {
 		retain_backbuffer = bit(0u),
 		backbuffer_dirty = bit(1u),
-		caret_visible = bit(2u)
+		caret_visible = bit(2u),
+		headless = bit(3u),
+
+		// Attribute caps are plain SGR and can be composed
+		cap_ansi_sgr = bit(4u),
+		// set_a_foreground and set_a_background are absent or plain
+		// SGR colors and can be composed with other attributes
+		cap_ansi_color = bit(5u),
+		// Cursor stays in the last column after writing to it
+		cap_deferred_wrap = bit(6u),
+
+		// tty is in O_NONBLOCK mode for output
+		nonblocking_output = bit(7u),
+		// Output is waiting for the tty to become writable
+		output_pending = bit(8u),
+		// A frame was skipped while output was backlogged
+		present_deferred = bit(9u),
+		// Frames are queued up to the pending limit instead of
+		// being coalesced as soon as the tty stops accepting output
+		queue_frames = bit(10u),
+		// change_scroll_region is plain DECSTBM
+		cap_ansi_scroll_region = bit(11u),
+		// present() redraws scrolled rows instead of detecting the
+		// scroll
+		no_scroll_detection = bit(12u),
+
+		// clr_eol is plain EL
+		cap_ansi_clr_eol = bit(13u),
+		// erase_chars is plain ECH
+		cap_ansi_erase_chars = bit(14u),
+		// repeat_char is plain REP
+		cap_ansi_repeat_char = bit(15u),
+		// Erased cells take the current background color
+		cap_back_color_erase = bit(16u),
+
+		// present() wraps frames in synchronized updates when the
+		// tty supports them
+		sync_output = bit(17u),
+		// tty reported support for synchronized updates (mode 2026)
+		cap_sync_output = bit(18u),
+		// A synchronized update was begun and is closed by the next
+		// flush
+		sync_begun = bit(19u),
+		// Waiting for the reply to the synchronized update mode query
+		sync_probe_pending = bit(20u),
+
+		// cursor_address is plain CUP
+		cap_ansi_cursor_address = bit(21u),
+		// parm_right_cursor is plain CUF
+		cap_ansi_parm_right_cursor = bit(22u),
+
+		// The entry has the RGB extended cap: colors past the basic
+		// eight are direct RGB values in the color caps
+		cap_ext_rgb = bit(23u),
+		// The entry has a Sync extended cap for mode 2026, so the tty
+		// needn't be asked whether it supports synchronized updates
+		cap_ext_sync = bit(24u)
 	};
 
 	enum class CapCache : unsigned {
@@ -149,6 +193,26 @@ private:
 		keypad_local,
 		keypad_xmit,
 
+		carriage_return,
+		cursor_down,
+		cursor_right,
+
+		scroll_forward,
+		scroll_reverse,
+		insert_line,
+		delete_line,
+
+		COUNT
+	};
+
+	// Parametrized caps, compiled by update_cache()
+	enum class ParmCap : unsigned {
+		cursor_address = 0u,
+		parm_right_cursor,
+		set_a_foreground,
+		set_a_background,
+		change_scroll_region,
+
 		COUNT
 	};
 
@@ -176,6 +240,171 @@ private:
 	};
 	using kdn_vector_type = aux::vector<KeyDecodeNode>;
 
+	// Dirty column span [x0, x1) of a back buffer row; empty when
+	// x0 >= x1
+	struct DirtySpan final {
+		geom_value_type x0;
+		geom_value_type x1;
+
+		bool
+		empty() const noexcept {
+			return x0 >= x1;
+		}
+
+		void
+		add(
+			geom_value_type const add_x0,
+			geom_value_type const add_x1
+		) noexcept {
+			if (empty()) {
+				x0 = add_x0;
+				x1 = add_x1;
+			} else {
+				x0 = min_ce(x0, add_x0);
+				x1 = max_ce(x1, add_x1);
+			}
+		}
+
+		void
+		reset() noexcept {
+			x0 = 0;
+			x1 = 0;
+		}
+	};
+	using dirty_vector_type = aux::vector<DirtySpan>;
+
+	// Row content hashes for scroll detection. front is the hash of
+	// the front buffer row, computed on demand; back is the hash of
+	// the back buffer row, computed by present() when detecting.
+	struct RowHash final {
+		std::uint64_t front;
+		std::uint64_t back;
+		bool front_valid;
+	};
+	using row_hash_vector_type = aux::vector<RowHash>;
+
+	// Open-addressed table from front row hash to row; row is -1 for
+	// an empty slot and -2 if several rows have the hash
+	struct HashSlot final {
+		std::uint64_t hash;
+		geom_value_type row;
+	};
+	using hash_slot_vector_type = aux::vector<HashSlot>;
+
+	// Grapheme clusters that don't fit in a cell's block, indexed by
+	// the cells that refer to them (see tty::cluster_ref_unit).
+	// Equal clusters always have the same index. Clusters that no
+	// cell refers to are dropped and the rest renumbered when the
+	// table doubles, on resize and on close.
+	using cluster_map_type = aux::unordered_map<String, std::uint32_t>;
+	using cluster_vector_type = aux::vector<String const*>;
+
+	// Direct-mapped cache from an attribute transition to the
+	// sequence written for it. The sequence depends on the previous
+	// attributes when it is an SGR delta; otherwise from_fg and
+	// from_bg are zero. An entry is empty when to_fg is ~0u.
+	struct SGRCacheEntry final {
+		unsigned from_fg;
+		unsigned from_bg;
+		unsigned to_fg;
+		unsigned to_bg;
+		std::uint8_t size;
+		char data[sgr_cache_data_size];
+	};
+
+	// Direct-mapped cache from a parametrized cap and its parameters
+	// to its output. An entry is empty when cap is ParmCap::COUNT.
+	struct ParmCacheEntry final {
+		std::int32_t p1;
+		std::int32_t p2;
+		std::uint8_t cap;
+		std::uint8_t size;
+		char data[parm_cache_data_size];
+	};
+
+	// Append-only output buffer. Storage only grows and is not
+	// initialized; units past size are unused capacity.
+	struct OutBuffer final {
+		std::unique_ptr<char[]> storage{};
+		std::size_t capacity{0u};
+		std::size_t size{0u};
+
+		OutBuffer() = default;
+
+		OutBuffer(
+			OutBuffer&& other
+		) noexcept
+			: storage(std::move(other.storage))
+			, capacity(other.capacity)
+			, size(other.size)
+		{
+			other.capacity = 0u;
+			other.size = 0u;
+		}
+
+		OutBuffer&
+		operator=(
+			OutBuffer&& other
+		) noexcept {
+			storage = std::move(other.storage);
+			capacity = other.capacity;
+			size = other.size;
+			other.capacity = 0u;
+			other.size = 0u;
+			return *this;
+		}
+
+		char*
+		data() noexcept {
+			return storage.get();
+		}
+
+		char const*
+		data() const noexcept {
+			return storage.get();
+		}
+
+		void
+		reserve(
+			std::size_t const new_capacity
+		) {
+			if (capacity < new_capacity) {
+				std::unique_ptr<char[]> new_storage{new char[new_capacity]};
+				if (0u < size) {
+					std::memcpy(new_storage.get(), storage.get(), size);
+				}
+				storage = std::move(new_storage);
+				capacity = new_capacity;
+			}
+		}
+
+		void
+		append(
+			char const* const units,
+			std::size_t const count
+		) {
+			if (capacity - size < count) {
+				reserve(max_ce(size + count, capacity << 1u));
+			}
+			std::memcpy(storage.get() + size, units, count);
+			size += count;
+		}
+
+		// Remove count units from the front
+		void
+		discard(
+			std::size_t const count
+		) noexcept {
+			std::memmove(storage.get(), storage.get() + count, size - count);
+			size -= count;
+		}
+
+		void
+		clear() noexcept {
+			size = 0u;
+		}
+	};
+
 	void
 	put_cap_cache(
 		CapCache const cap
@@ -217,23 +446,38 @@ private:
 	tty::TerminalInfo m_info{};
 
 	String m_cap_cache[enum_cast(CapCache::COUNT)]{};
+	tty::ParmProgram m_parm_programs[enum_cast(ParmCap::COUNT)]{};
 	unsigned m_cap_max_colors{8u};
+	unsigned m_opt_max_colors{0u};
 	kdn_vector_type m_key_decode_graph{};
 
 	tty::fd_type m_epoll_fd{tty::FD_INVALID};
 	duct::IO::dynamic_streambuf m_streambuf_in {inbuf_size, 0u, inbuf_size};
-	duct::IO::dynamic_streambuf m_streambuf_out{outbuf_size};
-	moveable_ostream m_stream_out{m_streambuf_out};
+	OutBuffer m_out{};
+	std::size_t m_out_pending_max{out_pending_max_default};
 
 	Vec2 m_tty_size{0, 0};
 	Vec2 m_caret_pos{0, 0};
+	// Output cursor position; components are -1 when unknown
+	Vec2 m_out_pos{-1, -1};
+
+	Vec2 m_headless_size{0, 0};
+	String m_headless_input{};
+	String m_headless_output{};
 
 	unsigned m_attr_fg_last{tty::Color::term_default};
 	unsigned m_attr_bg_last{tty::Color::term_default};
+	SGRCacheEntry m_sgr_cache[sgr_cache_size];
+	ParmCacheEntry m_parm_cache[parm_cache_size];
 
-	aux::vector<bool> m_dirty_rows{};
+	dirty_vector_type m_dirty_rows{};
+	row_hash_vector_type m_row_hashes{};
+	hash_slot_vector_type m_hash_slots{};
 	cell_vector_type m_cell_backbuffer {};
 	cell_vector_type m_cell_frontbuffer{};
+	cluster_map_type m_cluster_map{};
+	cluster_vector_type m_clusters{};
+	std::size_t m_cluster_compact_at{cluster_compact_min};
 
 	struct {
 		struct {
@@ -310,7 +554,20 @@ public:
 	*/
 	bool
 	is_open() const noexcept {
-		return tty::FD_INVALID != m_tty_fd;
+		return
+			tty::FD_INVALID != m_tty_fd ||
+			m_states.test(State::headless)
+		;
+	}
+
+	/**
+		Check if the terminal is headless.
+
+		@sa open_headless(Vec2 const&)
+	*/
+	bool
+	is_headless() const noexcept {
+		return m_states.test(State::headless);
 	}
 
 	/**
@@ -385,6 +642,133 @@ public:
 	) noexcept {
 		m_states.set(State::retain_backbuffer, enable);
 	}
+
+	/**
+		Enable or disable non-blocking output.
+
+		@note This is disabled by default. When enabled, the tty is
+		put in @c O_NONBLOCK mode and output that can't be written
+		immediately is kept until the tty is writable, at which point
+		poll() writes it. While output is backlogged, present() skips
+		the frame; its changes are emitted with the next present() or
+		by poll() once the output has drained.
+
+		@param enable Whether to enable or disable non-blocking
+		output.
+
+		@sa set_opt_coalesce_frames(),
+		set_opt_output_pending_max()
+	*/
+	void
+	set_opt_nonblocking_output(
+		bool const enable
+	);
+
+	/**
+		Enable or disable frame coalescing.
+
+		@note This is enabled by default and only applies when
+		non-blocking output is enabled. When enabled, output is
+		backlogged as soon as the tty stops accepting it, so at most
+		one frame is waiting to be written and the next frame is a
+		single diff of everything that changed in the meantime. When
+		disabled, frames are queued until the pending output limit
+		is exceeded.
+
+		@param enable Whether to enable or disable coalescing.
+	*/
+	void
+	set_opt_coalesce_frames(
+		bool const enable
+	) noexcept {
+		m_states.set(State::queue_frames, !enable);
+	}
+
+	/**
+		Set pending output limit.
+
+		@note The default is 64KiB. This only applies when
+		non-blocking output is enabled.
+
+		@param size Number of bytes that may be waiting to be written
+		before frames are skipped.
+	*/
+	void
+	set_opt_output_pending_max(
+		std::size_t const size
+	) noexcept {
+		m_out_pending_max = size;
+	}
+
+	/**
+		Enable or disable scroll detection.
+
+		@note This is enabled by default. When enabled, present()
+		detects blocks of rows that moved vertically since the last
+		frame and scrolls the terminal screen to move them, rather
+		than redrawing them. Rows are compared by hash, and only on
+		frames where several rows changed.
+
+		@param enable Whether to enable or disable scroll detection.
+
+		@sa scroll_region()
+	*/
+	void
+	set_opt_detect_scroll(
+		bool const enable
+	) noexcept {
+		m_states.set(State::no_scroll_detection, !enable);
+	}
+
+	/**
+		Set the number of colors the terminal can display.
+
+		@note The default is 0, which uses the terminfo
+		@c max_colors cap (or 8 if the cap is absent). Colors that
+		can't be displayed are reduced to the nearest displayable
+		color: 256-color palette indices are used from 256 colors,
+		bright colors from 16 colors, and 24-bit RGB colors are
+		written directly from 0x1000000 colors.
+
+		@param count Number of colors, or 0 to use the terminfo cap.
+
+		@sa tty::make_color_index(),
+		tty::make_color_rgb()
+	*/
+	void
+	set_opt_max_colors(
+		unsigned const count
+	);
+
+	/**
+		Enable or disable synchronized output.
+
+		@note This is disabled by default. When enabled, the terminal
+		is asked whether it supports synchronized updates (DEC private
+		mode 2026), and if it does, the output of each present() and
+		scroll_region() is wrapped in begin/end synchronized update
+		sequences so that the terminal displays the frame at once even
+		if it is split across several writes. The query is sent on
+		open (or when this is enabled on an open terminal), and the
+		reply is consumed by poll(); frames are not wrapped until the
+		reply is received. The query is skipped if the terminfo entry
+		has a @c Sync extended capability for mode 2026.
+
+		@param enable Whether to enable or disable synchronized
+		output.
+	*/
+	void
+	set_opt_sync_output(
+		bool const enable
+	);
+
+	/**
+		Get the number of bytes waiting to be written.
+	*/
+	std::size_t
+	output_pending() const noexcept {
+		return m_out.size;
+	}
 /// @}
 
 /** @name Input control */ /// @{
@@ -436,6 +820,10 @@ public:
 		@note If @a x or @a y are out-of-bounds, this function will
 		fail silently.
 
+		@note A wide cell is followed by its continuation cell, or
+		put as a blank if it doesn't fit. Wide cells split by the
+		put are blanked. Continuation cells can't be put.
+
 		@param x X position.
 		@param y Y position.
 		@param cell %Cell to put.
@@ -453,19 +841,28 @@ public:
 		@note If @a x or @a y are out-of-bounds, this function will
 		fail silently.
 
+		@note Wide code points take two columns; those that don't fit
+		are put as a blank. Combining code points join the cluster of
+		the previous cell put by this call; clusters that don't fit in
+		the cell's block are stored by the terminal. If the buffers
+		refer to more than 2<sup>23</sup> such clusters, further
+		combining code points that don't fit are dropped.
+
 		@param x X position.
 		@param y Y position.
 		@param seq %Sequence to put.
-		@param points Maximum number of code points to put.
+		@param columns Maximum number of columns to put.
 		@param attr_fg Foreground attributes.
 		@param attr_bg Background attributes.
+
+		@sa txt::sequence_width()
 	*/
 	void
 	put_sequence(
 		geom_value_type x,
 		geom_value_type const y,
 		txt::Sequence const& seq,
-		std::size_t const points,
+		std::size_t const columns,
 		tty::attr_type const attr_fg = tty::Color::term_default,
 		tty::attr_type const attr_bg = tty::Color::term_default
 	) noexcept;
@@ -539,7 +936,7 @@ public:
 	/**
 		Clear the back buffer.
 
-		@param cell Fill cell.
+		@param cell Fill cell. This must not be a wide cell.
 	*/
 	void
 	clear_back(
@@ -549,6 +946,9 @@ public:
 	/**
 		Clear a rectangle of the back buffer.
 
+		@note Wide cells split by the rectangle are blanked. @a cell
+		must not be a wide cell.
+
 		@param rect Rectangle to clear.
 		@param cell Fill cell.
 	*/
@@ -557,6 +957,83 @@ public:
 		Rect const& rect,
 		tty::Cell const& cell = tty::s_cell_default
 	) noexcept;
+
+	/**
+		Scroll a rectangle of the buffers.
+
+		Rows in the rectangle are shifted up by @a lines, or down if
+		@a lines is negative. Exposed rows are cleared to
+		tty::s_cell_default.
+
+		If the rectangle spans the width of the terminal and the
+		terminal has scrolling caps, the terminal screen is scrolled
+		and both buffers are shifted, so present() only emits what is
+		drawn to the exposed rows. Otherwise only the back buffer is
+		shifted and present() redraws the rectangle.
+
+		@returns @c true if the terminal screen was scrolled.
+		@param rect Rectangle to scroll.
+		@param lines Number of rows to scroll by.
+	*/
+	bool
+	scroll_region(
+		Rect const& rect,
+		geom_value_type const lines
+	);
+/// @}
+
+/** @name Headless operation */ /// @{
+	/**
+		Get output emitted by a headless terminal.
+
+		@note Output accumulates across flushes until
+		clear_headless_output() is called.
+	*/
+	String const&
+	headless_output() const noexcept {
+		return m_headless_output;
+	}
+
+	/**
+		Clear output emitted by a headless terminal.
+	*/
+	void
+	clear_headless_output() noexcept {
+		m_headless_output.clear();
+	}
+
+	/**
+		Queue input for a headless terminal.
+
+		@note Input is consumed by poll() exactly as if it were read
+		from a terminal device.
+
+		@param seq %Sequence of input units.
+	*/
+	void
+	push_headless_input(
+		txt::Sequence const& seq
+	) {
+		m_headless_input.append(seq.data, seq.size);
+	}
+
+	/**
+		Set the size of a headless terminal.
+
+		@note A tty::EventType::resize event is emitted by the next
+		poll() if @a size differs from the current size.
+
+		@param size New size.
+	*/
+	void
+	set_headless_size(
+		Vec2 const& size
+	) noexcept {
+		m_headless_size = size;
+		if (!(size == m_tty_size)) {
+			m_ev_pending.resize.pending = true;
+		}
+	}
 /// @}
 
 /** @name Events */ /// @{
@@ -659,6 +1136,34 @@ public:
 		bool const use_sigwinch
 	);
 
+	/**
+		Open headless terminal.
+
+		@note A headless terminal has no device. Output is appended
+		to an in-memory sink instead of being written to a file
+		descriptor, and input is fed by push_headless_input().
+		This exercises the same rendering and input paths as a
+		device-backed terminal.
+
+		@post On success, <code>is_open() && is_headless()</code>.
+
+		@throws Error{ErrorCode::tty_terminal_already_open}
+		If the terminal is already open.
+
+		@throws Error{ErrorCode::tty_terminal_info_uninitialized}
+		If the terminal info is uninitialized.
+
+		@param size Initial size.
+
+		@sa headless_output(),
+			push_headless_input(txt::Sequence const&),
+			set_headless_size(Vec2 const&)
+	*/
+	void
+	open_headless(
+		Vec2 const& size
+	);
+
 	/**
 		Close the terminal.
 	*/
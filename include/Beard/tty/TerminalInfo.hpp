@@ -13,6 +13,9 @@
 #include <Beard/String.hpp>
 #include <Beard/tty/Caps.hpp>
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <iosfwd>
 
 namespace Beard {
@@ -29,10 +32,15 @@ class TerminalInfo;
 /**
 	%Terminal information.
 
-	@note This class does not deserialize the ncurses extended
-	storage format.
+	Capabilities are read in place from the compiled entry, which is
+	either mapped from a file or held in a buffer. Capability strings
+	are looked up through a dense offset table into the entry's
+	string table.
+
+	Both the legacy (16-bit number) and the 32-bit number formats are
+	read, along with the ncurses extended section. Extended
+	capabilities are looked up by name; see `man 5 user_caps`.
 
-	@par
 	@note See `man 5 term`.
 */
 class TerminalInfo final {
@@ -40,27 +48,78 @@ public:
 	/** Name vector type. */
 	using name_vector_type = aux::vector<String>;
 
-	/**
-		Capability string map type.
-	*/
-	using cap_string_map_type
-	= aux::unordered_map<
-		unsigned,
-		String
-	>;
-
 private:
-	using cap_flag_vector_type = aux::vector<std::uint8_t>;
-	using cap_number_vector_type = aux::vector<std::int16_t>;
+	enum : std::uint16_t {
+		string_offset_none = 0xFFFFu,
+	};
+
+	enum class ExtKind : std::uint8_t {
+		flag,
+		number,
+		string,
+	};
+
+	// Extended capability; name and string value are offsets into
+	// the extended string table
+	struct ExtCap final {
+		std::uint16_t name;
+		// Flag value, number index or string offset
+		std::uint16_t value;
+		ExtKind kind;
+	};
+	using ext_cap_vector_type = aux::vector<ExtCap>;
+
+	// Positions are relative to the start of the entry
+	struct Layout final {
+		std::size_t size;
+		std::size_t flags;
+		std::size_t numbers;
+		std::size_t string_table;
+		std::size_t ext_numbers;
+		std::size_t ext_string_table;
+		unsigned number_size;
+		unsigned flag_count;
+		unsigned number_count;
+		unsigned string_count;
+	};
 
 	bool m_initialized;
 	name_vector_type m_names;
-	cap_flag_vector_type m_cap_flags;
-	cap_number_vector_type m_cap_numbers;
-	cap_string_map_type m_cap_strings;
+	aux::shared_ptr<std::uint8_t const> m_map;
+	aux::vector<std::uint8_t> m_buffer;
+	std::uint8_t const* m_data;
+	Layout m_layout;
+	// Offsets into the string table by capability
+	std::uint16_t m_string_offsets[enum_cast(tty::CapString::COUNT)];
+	// Sorted by name
+	ext_cap_vector_type m_ext_caps;
 
 	TerminalInfo& operator=(TerminalInfo const&) = delete;
 
+	void
+	release() noexcept;
+
+	void
+	parse(
+		std::size_t const size
+	);
+
+	void
+	parse_ext(
+		std::size_t const pos,
+		std::size_t const size
+	);
+
+	ExtCap const*
+	find_ext_cap(
+		char const* const name
+	) const noexcept;
+
+	tty::CapNumberValue
+	read_number(
+		std::size_t const pos
+	) const noexcept;
+
 public:
 /** @name Constructors and destructor */ /// @{
 	/** Destructor. */
@@ -70,7 +129,12 @@ public:
 	TerminalInfo() noexcept;
 	/** Move constructor. */
 	TerminalInfo(TerminalInfo&&) noexcept;
-	/** Copy constructor. */
+	/**
+		Copy constructor.
+
+		@note A copy of a mapped entry shares the mapping; otherwise
+		the copy holds the entry in a buffer.
+	*/
 	TerminalInfo(TerminalInfo const&);
 /// @}
 
@@ -88,6 +152,14 @@ public:
 		return m_initialized;
 	}
 
+	/**
+		Check if the entry is mapped from a file.
+	*/
+	bool
+	is_mapped() const noexcept {
+		return static_cast<bool>(m_map);
+	}
+
 	/**
 		Get name collection.
 	*/
@@ -110,8 +182,8 @@ public:
 		tty::CapFlag const cap
 	) const noexcept {
 		return
-			m_cap_flags.size() > enum_cast(cap)
-			? 0u != m_cap_flags[enum_cast(cap)]
+			m_layout.flag_count > enum_cast(cap)
+			? 0u != m_data[m_layout.flags + enum_cast(cap)]
 			: false
 		;
 	}
@@ -121,7 +193,7 @@ public:
 	*/
 	std::size_t
 	cap_flag_count() const noexcept {
-		return m_cap_flags.size();
+		return m_layout.flag_count;
 	}
 
 	/**
@@ -135,37 +207,43 @@ public:
 	tty::CapNumberValue
 	cap_number(
 		tty::CapNumber const cap
-	) const noexcept {
-		return
-			m_cap_numbers.size() > enum_cast(cap)
-			? m_cap_numbers[enum_cast(cap)]
-			: tty::CAP_NUMBER_NOT_SUPPORTED
-		;
-	}
+	) const noexcept;
 
 	/**
 		Get capability number count.
 	*/
 	std::size_t
 	cap_number_count() const noexcept {
-		return m_cap_numbers.size();
+		return m_layout.number_count;
 	}
 
 	/**
 		Lookup a capability string.
 
-		@returns @c true if @a iterator points to a valid iterator,
-		or @c false if @a cap was not found.
+		@note @a value is unmodified if the return value is @c false.
+
+		@returns @c true if the capability was found and @a value
+		refers to it, or @c false if @a cap was not found.
 		@param cap Capability string to lookup.
-		@param iterator Capability string map iterator.
+		@param value Result value.
 	*/
 	bool
 	lookup_cap_string(
 		tty::CapString const cap,
-		cap_string_map_type::const_iterator& iterator
+		tty::CapStringValue& value
 	) const noexcept {
-		iterator = m_cap_strings.find(enum_cast(cap));
-		return m_cap_strings.cend() != iterator;
+		if (
+			enum_cast(tty::CapString::COUNT) <= enum_cast(cap) ||
+			string_offset_none == m_string_offsets[enum_cast(cap)]
+		) {
+			return false;
+		}
+		value.data = reinterpret_cast<char const*>(
+			m_data + m_layout.string_table
+			+ m_string_offsets[enum_cast(cap)]
+		);
+		value.size = std::strlen(value.data);
+		return true;
 	}
 
 	/**
@@ -182,37 +260,126 @@ public:
 	cap_string(
 		tty::CapString const cap,
 		String& value
+	) const;
+
+	/**
+		Get capability string count.
+	*/
+	std::size_t
+	cap_string_count() const noexcept {
+		return m_layout.string_count;
+	}
+/// @}
+
+/** @name Extended capabilities */ /// @{
+	/**
+		Get the value of an extended capability flag.
+
+		@returns @c true if the flag is present; @c false if it is
+		absent or @a name is not a flag.
+		@param name Capability name, e.g. @c "AX".
+	*/
+	tty::CapFlagValue
+	ext_cap_flag(
+		char const* const name
+	) const noexcept;
+
+	/**
+		Get the value of an extended capability number.
+
+		@returns The value of the capability number,
+		or tty::CAP_NUMBER_NOT_SUPPORTED if it is absent or @a name
+		is not a number.
+		@param name Capability name, e.g. @c "RGB".
+	*/
+	tty::CapNumberValue
+	ext_cap_number(
+		char const* const name
+	) const noexcept;
+
+	/**
+		Lookup an extended capability string.
+
+		@note @a value is unmodified if the return value is @c false.
+
+		@returns @c true if the capability was found and @a value
+		refers to it, or @c false if it is absent or @a name is not a
+		string.
+		@param name Capability name, e.g. @c "Sync".
+		@param value Result value.
+	*/
+	bool
+	lookup_ext_cap_string(
+		char const* const name,
+		tty::CapStringValue& value
+	) const noexcept;
+
+	/**
+		Check if an extended capability is present, of any type.
+
+		@param name Capability name.
+	*/
+	bool
+	has_ext_cap(
+		char const* const name
 	) const noexcept {
-		auto const it = m_cap_strings.find(enum_cast(cap));
-		if (m_cap_strings.cend() != it) {
-			value.assign(it->second);
-			return true;
-		}
-		return false;
+		return nullptr != find_ext_cap(name);
 	}
 
 	/**
-		Get capability string map.
+		Get the name of an extended capability.
+
+		@note Names are sorted.
+
+		@param index Index of the capability; must be less than
+		ext_cap_count().
 	*/
-	cap_string_map_type const&
-	cap_string_map() const noexcept {
-		return m_cap_strings;
+	char const*
+	ext_cap_name(
+		std::size_t const index
+	) const noexcept {
+		return reinterpret_cast<char const*>(
+			m_data + m_layout.ext_string_table + m_ext_caps[index].name
+		);
 	}
 
 	/**
-		Get capability string count.
+		Get extended capability count.
 	*/
 	std::size_t
-	cap_string_count() const noexcept {
-		return m_cap_strings.size();
+	ext_cap_count() const noexcept {
+		return m_ext_caps.size();
 	}
 /// @}
 
 /** @name Serialization */ /// @{
+	/**
+		Load from a compiled terminfo file.
+
+		@note The file is mapped and capabilities are read from the
+		mapping. The entry is validated once here.
+
+		@par
+		@note Any stored properties are discarded before loading.
+
+		@throws Error{ErrorCode::serialization_io_failed}
+		If the file cannot be opened or mapped.
+
+		@throws Error{ErrorCode::serialization_data_malformed}
+		If malformed data is encountered.
+
+		@param path Path to the compiled entry.
+	*/
+	void
+	load(
+		String const& path
+	);
+
 	/**
 		Deserialize from stream.
 
-		@note @a stream need not be seekable.
+		@note @a stream need not be seekable. The entry is read into
+		a buffer and capabilities are read from it.
 
 		@par
 		@note Any stored properties are discarded before
@@ -0,0 +1,177 @@
+/**
+@copyright MIT license; see @ref index or the accompanying LICENSE file.
+
+@file
+@brief %Terminal information cache.
+*/
+
+#pragma once
+
+#include <Beard/config.hpp>
+#include <Beard/aux.hpp>
+#include <Beard/String.hpp>
+#include <Beard/tty/TerminalInfo.hpp>
+
+#include <cstddef>
+#include <mutex>
+
+namespace Beard {
+namespace tty {
+
+// Forward declarations
+class TerminalInfoCache;
+
+/**
+	@addtogroup tty
+	@{
+*/
+
+/**
+	%Terminal information cache.
+
+	Entries are looked up by terminal name in the terminfo
+	directories and loaded once; later lookups share the same
+	immutable tty::TerminalInfo. Copying a shared entry (such as into
+	a tty::Terminal) shares its mapping rather than reloading it.
+
+	The directories are searched in this order:
+
+	-# @c $TERMINFO
+	-# @c $HOME/.terminfo
+	-# each directory in @c $TERMINFO_DIRS (colon-separated)
+	-# @c /etc/terminfo, @c /lib/terminfo and
+	   @c /usr/share/terminfo
+
+	Within a directory, an entry is found under the first character
+	of its name (e.g. @c x/xterm) or its hexadecimal value
+	(e.g. @c 78/xterm).
+
+	@note All operations are thread-safe. Entries are loaded outside
+	of the cache's lock, so lookups of other names don't wait on a
+	load; concurrent lookups of the same name wait for the first.
+*/
+class TerminalInfoCache final {
+public:
+	/** Shared terminal information type. */
+	using info_pointer_type = aux::shared_ptr<tty::TerminalInfo const>;
+
+	/**
+		Lookup statistics.
+	*/
+	struct Stats final {
+		/** Number of lookups served from the cache. */
+		std::size_t hits;
+		/** Number of lookups that searched the directories. */
+		std::size_t misses;
+		/** Number of cached entries. */
+		std::size_t size;
+	};
+
+private:
+	// An entry is loaded by the first lookup under the entry's own
+	// lock; later lookups wait on that lock rather than the cache's
+	struct Entry final {
+		std::mutex mutex{};
+		bool loaded{false};
+		info_pointer_type info{};
+	};
+
+	using entry_map_type
+		= aux::unordered_map<String, aux::shared_ptr<Entry>>;
+
+	mutable std::mutex m_mutex;
+	entry_map_type m_entries;
+	std::size_t m_hits;
+	std::size_t m_misses;
+
+	TerminalInfoCache(TerminalInfoCache const&) = delete;
+	TerminalInfoCache& operator=(TerminalInfoCache const&) = delete;
+
+public:
+/** @name Constructors and destructor */ /// @{
+	/** Destructor. */
+	~TerminalInfoCache() noexcept;
+
+	/** Default constructor. */
+	TerminalInfoCache();
+/// @}
+
+/** @name Properties */ /// @{
+	/**
+		Get the process-wide cache.
+	*/
+	static TerminalInfoCache&
+	process();
+
+	/**
+		Get lookup statistics.
+	*/
+	Stats
+	stats() const;
+/// @}
+
+/** @name Operations */ /// @{
+	/**
+		Find the path to a compiled terminfo entry.
+
+		@note This does not use the cache.
+
+		@returns @c true if an entry was found and stored in
+		@a path; @c false otherwise, or if @a name is not a valid
+		terminal name.
+		@param name %Terminal name.
+		@param path Result path.
+	*/
+	static bool
+	locate(
+		String const& name,
+		String& path
+	);
+
+	/**
+		Find terminal information by name, loading it if it is not
+		cached.
+
+		@note Names that are not found are not cached.
+
+		@throws Error{ErrorCode::serialization_io_failed}
+		If the entry found cannot be mapped.
+
+		@throws Error{ErrorCode::serialization_data_malformed}
+		If the entry found is malformed.
+
+		@returns The shared terminal information, or @c nullptr if
+		@a name was not found.
+		@param name %Terminal name.
+	*/
+	info_pointer_type
+	find(
+		String const& name
+	);
+
+	/**
+		Find terminal information for @c $TERM.
+
+		@throws See find().
+
+		@returns The shared terminal information, or @c nullptr if
+		@c $TERM is unset or was not found.
+	*/
+	info_pointer_type
+	find_term();
+
+	/**
+		Drop all cached entries.
+
+		@note Entries that are still shared are unaffected, and
+		statistics are kept.
+	*/
+	void
+	clear();
+/// @}
+};
+
+/** @} */ // end of doc-group tty
+
+} // namespace tty
+} // namespace Beard
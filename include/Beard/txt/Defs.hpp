@@ -15,6 +15,8 @@
 #include <duct/EncodingUtils.hpp>
 
 #include <cstring>
+#include <algorithm>
+#include <iterator>
 
 namespace Beard {
 namespace txt {
@@ -34,6 +36,36 @@ struct UTF8Block;
 */
 using EncUtils = duct::UTF8Utils;
 
+/**
+	Get the number of columns a code point takes on a terminal.
+
+	@note This is 0 for combining marks and other zero-width code
+	points, 2 for East Asian wide and full-width code points and 1
+	for everything else, including invalid code points. The table
+	is generated by scripts/gen_width_table.py.
+
+	@param cp Code point.
+*/
+unsigned
+code_point_width(
+	char32 const cp
+) noexcept;
+
+/**
+	Get the number of columns a sequence takes on a terminal.
+
+	@note This is the number of columns tty::Terminal::put_sequence()
+	puts @a seq in, with room for all of it: invalid code unit
+	sub-sequences take a column each, and combining code points at
+	the start of @a seq take none.
+
+	@param seq %Sequence.
+*/
+std::size_t
+sequence_width(
+	txt::Sequence const& seq
+) noexcept;
+
 /**
 	%Extents.
 */
@@ -137,8 +169,11 @@ struct Sequence final {
 /**
 	UTF-8 block of code units.
 
-	@note This is used to store an entire UTF-8 code unit sequence
-	representing a single code point.
+	@note This is used to store the UTF-8 code unit sequences of a
+	grapheme cluster: a code point followed by the combining code
+	points that fit in the block. Units past the cluster are always
+	zero, so blocks can be compared bytewise. tty::Terminal stores
+	longer clusters itself (see tty::cluster_ref_unit).
 */
 struct UTF8Block final {
 /** @name Properties */ /// @{
@@ -147,10 +182,21 @@ struct UTF8Block final {
 
 	/**
 		Get the number of units in the block.
+
+		@note This is at least 1, even if the first unit is zero.
 	*/
 	std::size_t
 	size() const noexcept {
-		return txt::EncUtils::required_first_whole(units[0u]);
+		static_assert(
+			4u == txt::EncUtils::max_units,
+			"size() expects 4 units"
+		);
+		return
+			  '\0' == units[1u] ? 1u
+			: '\0' == units[2u] ? 2u
+			: '\0' == units[3u] ? 3u
+			: 4u
+		;
 	}
 /// @}
 
@@ -159,7 +205,10 @@ struct UTF8Block final {
 	~UTF8Block() noexcept = default;
 
 	/** Default constructor. */
-	UTF8Block() noexcept = default;
+	constexpr
+	UTF8Block() noexcept
+		: units{}
+	{}
 	/** Copy constructor. */
 	UTF8Block(UTF8Block const&) noexcept = default;
 	/** Move constructor. */
@@ -221,7 +270,7 @@ struct UTF8Block final {
 	operator=(
 		char const c
 	) noexcept {
-		units[0u] = c;
+		assign(c);
 		return *this;
 	}
 
@@ -250,6 +299,7 @@ struct UTF8Block final {
 		char const c
 	) noexcept {
 		units[0u] = c;
+		std::fill(units + 1u, std::end(units), '\0');
 	}
 
 	/**
@@ -267,10 +317,14 @@ struct UTF8Block final {
 	assign(
 		char32 const cp
 	) noexcept {
-		txt::EncUtils::encode(
-			cp,
-			std::begin(units),
-			duct::CHAR_REPLACEMENT
+		std::fill(
+			txt::EncUtils::encode(
+				cp,
+				std::begin(units),
+				duct::CHAR_REPLACEMENT
+			),
+			std::end(units),
+			'\0'
 		);
 	}
 
@@ -290,17 +344,64 @@ struct UTF8Block final {
 		txt::EncUtils::char_type const* const data,
 		std::size_t const size
 	) noexcept {
-		std::memcpy(
-			units,
-			data,
-			(txt::EncUtils::max_units < size)
-				? txt::EncUtils::max_units
-				: size
-		);
+		std::size_t const count
+			= (txt::EncUtils::max_units < size)
+			? txt::EncUtils::max_units
+			: size
+		;
+		std::memcpy(units, data, count);
+		std::fill(units + count, std::end(units), '\0');
+	}
+
+	/**
+		Append a code unit sequence to the cluster.
+
+		@warning @a data is not checked for erroneous encoding.
+
+		@returns @c true if the sequence fit in the block; otherwise
+		the block is unchanged.
+		@param data Code unit sequence.
+		@param size Number of units in sequence.
+	*/
+	inline bool
+	append(
+		txt::EncUtils::char_type const* const data,
+		std::size_t const size
+	) noexcept {
+		std::size_t const used = this->size();
+		if (txt::EncUtils::max_units - used < size) {
+			return false;
+		}
+		std::memcpy(units + used, data, size);
+		return true;
 	}
 /// @}
 };
 
+/** @name UTF8Block comparison */ /// @{
+/**
+	Equal-to operator for UTF8Block.
+*/
+inline bool
+operator==(
+	txt::UTF8Block const& x,
+	txt::UTF8Block const& y
+) noexcept {
+	return 0 == std::memcmp(x.units, y.units, sizeof(x.units));
+}
+
+/**
+	Not-equal-to operator for UTF8Block.
+*/
+inline bool
+operator!=(
+	txt::UTF8Block const& x,
+	txt::UTF8Block const& y
+) noexcept {
+	return !(x == y);
+}
+/// @}
+
 /** @} */ // end of doc-group txt
 
 } // namespace txt
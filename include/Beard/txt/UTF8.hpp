@@ -0,0 +1,124 @@
+/**
+@copyright MIT license; see @ref index or the accompanying LICENSE file.
+
+@file
+@brief UTF-8 scanning kernels.
+*/
+
+#pragma once
+
+#include <Beard/config.hpp>
+#include <Beard/txt/Defs.hpp>
+
+#include <cstddef>
+
+namespace Beard {
+namespace txt {
+
+// Forward declarations
+enum class UTF8Impl : unsigned;
+struct UTF8Kernel;
+
+/**
+	@addtogroup txt
+	@{
+*/
+
+/**
+	UTF-8 kernel implementations.
+*/
+enum class UTF8Impl : unsigned {
+	/** Unit-by-unit scan with an 8-unit ASCII fast path. */
+	scalar = 0u,
+	/** SSE2 ASCII fast path and counting (x86). */
+	sse2,
+	/** AVX2 validation and counting (x86). */
+	avx2,
+
+/** @cond INTERNAL */
+	COUNT
+/** @endcond */
+};
+
+/**
+	UTF-8 scan function.
+
+	@param data Code unit sequence.
+	@param size Number of units in @a data.
+*/
+using utf8_scan_func_type = std::size_t (*)(
+	txt::EncUtils::char_type const* data,
+	std::size_t size
+) noexcept;
+
+/**
+	UTF-8 kernel.
+
+	Validates and counts UTF-8 code unit sequences.
+*/
+struct UTF8Kernel final {
+/** @name Properties */ /// @{
+	/** Implementation. */
+	txt::UTF8Impl impl;
+	/** Name. */
+	char const* name;
+
+	/**
+		Get the number of leading ASCII units.
+	*/
+	txt::utf8_scan_func_type ascii_prefix;
+
+	/**
+		Get the number of leading units that form complete, valid
+		sequences.
+
+		@note Overlong encodings, surrogates and code points above
+		U+10FFFF are invalid.
+	*/
+	txt::utf8_scan_func_type valid_prefix;
+
+	/**
+		Count code points.
+
+		@note This counts the units that are not continuation units,
+		which is the number of code points in valid UTF-8.
+	*/
+	txt::utf8_scan_func_type count_points;
+/// @}
+};
+
+/**
+	Check if a UTF-8 kernel implementation is supported by the CPU.
+
+	@param impl Implementation.
+*/
+bool
+utf8_supported(
+	txt::UTF8Impl const impl
+) noexcept;
+
+/**
+	Get a UTF-8 kernel.
+
+	@warning The kernel must be supported by the CPU.
+
+	@param impl Implementation.
+*/
+txt::UTF8Kernel const&
+utf8_kernel(
+	txt::UTF8Impl const impl
+) noexcept;
+
+/**
+	Get the fastest UTF-8 kernel supported by the CPU.
+
+	@note The kernel is selected by CPU feature detection on the
+	first call.
+*/
+txt::UTF8Kernel const&
+utf8_kernel() noexcept;
+
+/** @} */ // end of doc-group txt
+
+} // namespace txt
+} // namespace Beard
@@ -16,6 +16,7 @@ precore.import(".")
 
 precore.apply_global("beard.projects")
 precore.import("test")
+precore.import("bench")
 
 precore.action_clean("out")
 if _ACTION == "clean" then
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+# usage: gen_width_table.py > src/Beard/txt/Width.cpp
+# Generates the two-level code point width table behind
+# txt::code_point_width() from the Unicode database of the running
+# Python. Stage 1 maps each 256-code-point block to a stage 2 block of
+# 2-bit widths; identical stage 2 blocks are shared.
+
+import sys
+import unicodedata
+
+BLOCK_BITS = 8
+BLOCK_SIZE = 1 << BLOCK_BITS
+CP_END = 0x110000
+
+# Unassigned code points in these ranges are reserved for wide
+# ideographs
+WIDE_RESERVED = (
+	(0x3400, 0x4DBF),
+	(0x4E00, 0x9FFF),
+	(0xF900, 0xFAFF),
+	(0x20000, 0x2FFFD),
+	(0x30000, 0x3FFFD),
+)
+
+# Hangul medial vowels and final consonants join the preceding
+# initial consonant
+ZERO_EXTRA = (
+	(0x1160, 0x11FF),
+	(0xD7B0, 0xD7FF),
+)
+
+def in_ranges(cp, ranges):
+	return any(first <= cp <= last for first, last in ranges)
+
+def width(cp):
+	ch = chr(cp)
+	category = unicodedata.category(ch)
+	if cp == 0x00AD:
+		# Soft hyphen is displayed
+		return 1
+	if category in ("Mn", "Me", "Cf") or in_ranges(cp, ZERO_EXTRA):
+		return 0
+	if unicodedata.east_asian_width(ch) in ("W", "F"):
+		return 2
+	if category == "Cn" and in_ranges(cp, WIDE_RESERVED):
+		return 2
+	return 1
+
+def pack_block(first):
+	data = bytearray(BLOCK_SIZE // 4)
+	for i in range(BLOCK_SIZE):
+		data[i >> 2] |= width(first + i) << ((i & 3) << 1)
+	return bytes(data)
+
+def main():
+	blocks = []
+	block_ids = {}
+	stage1 = []
+	for first in range(0, CP_END, BLOCK_SIZE):
+		block = pack_block(first)
+		if block not in block_ids:
+			block_ids[block] = len(blocks)
+			blocks.append(block)
+		stage1.append(block_ids[block])
+	assert len(blocks) <= 0x100
+
+	out = sys.stdout
+	out.write(
+		"/**\n"
+		"@copyright MIT license; see @ref index or the accompanying LICENSE file.\n"
+		"*/\n"
+		"\n"
+		"// Generated by scripts/gen_width_table.py from Unicode %s data;\n"
+		"// do not edit.\n"
+		"\n"
+		"#include <Beard/config.hpp>\n"
+		"#include <Beard/txt/Defs.hpp>\n"
+		"\n"
+		"#include <cstdint>\n"
+		"\n"
+		"namespace Beard {\n"
+		"namespace txt {\n"
+		"\n"
+		"namespace {\n"
+		"\n"
+		"// Stage 2 block of each %u-code-point block\n"
+		"static std::uint8_t const\n"
+		"s_width_stage1[0x%X]{\n"
+		% (unicodedata.unidata_version, BLOCK_SIZE, len(stage1))
+	)
+	for i in range(0, len(stage1), 16):
+		out.write(
+			"\t" + " ".join("%u," % b for b in stage1[i : i + 16]) + "\n"
+		)
+	out.write(
+		"};\n"
+		"\n"
+		"// 2-bit widths, four code points to a byte\n"
+		"static std::uint8_t const\n"
+		"s_width_stage2[%u][%u]{\n"
+		% (len(blocks), BLOCK_SIZE // 4)
+	)
+	for block in blocks:
+		out.write("\t{\n")
+		for i in range(0, len(block), 16):
+			out.write(
+				"\t\t" + " ".join("0x%02X," % b for b in block[i : i + 16]) + "\n"
+			)
+		out.write("\t},\n")
+	out.write(
+		"};\n"
+		"\n"
+		"} // anonymous namespace\n"
+		"\n"
+		"unsigned\n"
+		"code_point_width(\n"
+		"\tchar32 const cp\n"
+		") noexcept {\n"
+		"\tif ((0x20u <= cp && 0x7Fu > cp) || 0x%Xu <= cp) {\n"
+		"\t\t// Printable ASCII; invalid code points\n"
+		"\t\treturn 1u;\n"
+		"\t}\n"
+		"\tunsigned const block = s_width_stage1[cp >> %uu];\n"
+		"\tunsigned const bits = s_width_stage2[block][(cp & 0x%02Xu) >> 2u];\n"
+		"\treturn (bits >> ((cp & 3u) << 1u)) & 3u;\n"
+		"}\n"
+		"\n"
+		"} // namespace txt\n"
+		"} // namespace Beard\n"
+		% (CP_END, BLOCK_BITS, BLOCK_SIZE - 1)
+	)
+
+if __name__ == "__main__":
+	main()
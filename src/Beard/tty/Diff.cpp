@@ -0,0 +1,402 @@
+/**
+@copyright MIT license; see @ref index or the accompanying LICENSE file.
+*/
+
+#include <Beard/config.hpp>
+#include <Beard/utility.hpp>
+#include <Beard/tty/Defs.hpp>
+#include <Beard/tty/Diff.hpp>
+
+#include <cstdint>
+#include <type_traits>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define BEARD_TTY_DIFF_X86
+	#include <immintrin.h>
+#endif
+
+namespace Beard {
+namespace tty {
+
+namespace {
+
+enum : std::size_t {
+	cell_size = sizeof(tty::Cell),
+	// Vector kernels compare 64-byte windows; find_equal() windows
+	// cover as many whole cells as fit
+	window_size = 64u,
+	window_cells = window_size / cell_size,
+};
+
+static_assert(
+	0u < window_cells && window_size > cell_size,
+	"tty::Cell is too large for the diff window"
+);
+
+// Bit of the first byte of each cell in a window
+static constexpr std::uint64_t
+cell_heads(
+	std::size_t const cell
+) noexcept {
+	return
+		window_cells == cell
+		? 0u
+		: (std::uint64_t{1u} << (cell * cell_size)) | cell_heads(cell + 1u)
+	;
+}
+
+static constexpr std::uint64_t const
+s_cell_heads = cell_heads(0u);
+
+// scalar
+
+static std::size_t
+scalar_find_differ(
+	tty::Cell const* const x,
+	tty::Cell const* const y,
+	std::size_t const count
+) noexcept {
+	std::size_t index = 0u;
+	for (; count > index && x[index] == y[index]; ++index) {}
+	return index;
+}
+
+static std::size_t
+scalar_find_equal(
+	tty::Cell const* const x,
+	tty::Cell const* const y,
+	std::size_t const count
+) noexcept {
+	std::size_t index = 0u;
+	for (; count > index && x[index] != y[index]; ++index) {}
+	return index;
+}
+
+static void
+scalar_fill(
+	tty::Cell* const dst,
+	std::size_t const count,
+	tty::Cell const& cell
+) noexcept {
+	std::fill(dst, dst + count, cell);
+}
+
+#ifdef BEARD_TTY_DIFF_X86
+
+static constexpr std::size_t
+gcd_ce(
+	std::size_t const x,
+	std::size_t const y
+) noexcept {
+	return 0u == y ? x : gcd_ce(y, x % y);
+}
+
+// Cells don't evenly divide a vector, so pattern fills repeat over
+// the least common multiple of the cell and vector sizes, which is a
+// whole number of each
+template<std::size_t vector_size>
+struct fill_period final {
+	enum : std::size_t {
+		cells = vector_size / gcd_ce(cell_size, vector_size),
+		vectors = cell_size / gcd_ce(cell_size, vector_size),
+	};
+};
+
+// Shared window walk; equal_mask() gives one bit per equal byte in
+// a 64-byte window. Always inlined so that equal_mask() is inlined
+// into the caller's instruction set.
+template<
+	std::uint64_t (&equal_mask)(unsigned char const*, unsigned char const*)
+>
+__attribute__((always_inline))
+inline static std::size_t
+window_find_differ(
+	tty::Cell const* const x,
+	tty::Cell const* const y,
+	std::size_t const count
+) noexcept {
+	// The first differing byte gives the cell, so windows needn't
+	// cover whole cells
+	auto const bx = reinterpret_cast<unsigned char const*>(x);
+	auto const by = reinterpret_cast<unsigned char const*>(y);
+	std::size_t const size = count * cell_size;
+	std::size_t offset = 0u;
+	for (; size - offset >= window_size; offset += window_size) {
+		std::uint64_t const differ = ~equal_mask(bx + offset, by + offset);
+		if (0u != differ) {
+			return
+				(offset + static_cast<std::size_t>(__builtin_ctzll(differ)))
+				/ cell_size
+			;
+		}
+	}
+	std::size_t const index = offset / cell_size;
+	return index + scalar_find_differ(x + index, y + index, count - index);
+}
+
+template<
+	std::uint64_t (&equal_mask)(unsigned char const*, unsigned char const*)
+>
+__attribute__((always_inline))
+inline static std::size_t
+window_find_equal(
+	tty::Cell const* const x,
+	tty::Cell const* const y,
+	std::size_t const count
+) noexcept {
+	auto const bx = reinterpret_cast<unsigned char const*>(x);
+	auto const by = reinterpret_cast<unsigned char const*>(y);
+	std::size_t index = 0u;
+	for (; (count - index) * cell_size >= window_size; index += window_cells) {
+		// Reduce each cell's bytes to its head bit, which is set only
+		// if every byte in the cell is equal
+		std::uint64_t equal
+			= equal_mask(bx + index * cell_size, by + index * cell_size);
+		std::size_t width = 1u;
+		for (; cell_size >= (width << 1u); width <<= 1u) {
+			equal &= equal >> width;
+		}
+		if (cell_size != width) {
+			equal &= equal >> (cell_size - width);
+		}
+		equal &= s_cell_heads;
+		if (0u != equal) {
+			return
+				index +
+				static_cast<std::size_t>(__builtin_ctzll(equal)) / cell_size
+			;
+		}
+	}
+	return index + scalar_find_equal(x + index, y + index, count - index);
+}
+
+// SSE2
+
+__attribute__((target("sse2")))
+inline static std::uint64_t
+sse2_equal_lane(
+	unsigned char const* const x,
+	unsigned char const* const y,
+	unsigned const lane
+) {
+	__m128i const vx = _mm_loadu_si128(
+		reinterpret_cast<__m128i const*>(x + (lane << 4u))
+	);
+	__m128i const vy = _mm_loadu_si128(
+		reinterpret_cast<__m128i const*>(y + (lane << 4u))
+	);
+	return static_cast<std::uint64_t>(static_cast<std::uint16_t>(
+		_mm_movemask_epi8(_mm_cmpeq_epi8(vx, vy))
+	)) << (lane << 4u);
+}
+
+__attribute__((target("sse2")))
+static std::uint64_t
+sse2_equal_mask(
+	unsigned char const* const x,
+	unsigned char const* const y
+) {
+	return
+		sse2_equal_lane(x, y, 0u) |
+		sse2_equal_lane(x, y, 1u) |
+		sse2_equal_lane(x, y, 2u) |
+		sse2_equal_lane(x, y, 3u)
+	;
+}
+
+__attribute__((target("sse2")))
+static std::size_t
+sse2_find_differ(
+	tty::Cell const* const x,
+	tty::Cell const* const y,
+	std::size_t const count
+) noexcept {
+	return window_find_differ<sse2_equal_mask>(x, y, count);
+}
+
+__attribute__((target("sse2")))
+static std::size_t
+sse2_find_equal(
+	tty::Cell const* const x,
+	tty::Cell const* const y,
+	std::size_t const count
+) noexcept {
+	return window_find_equal<sse2_equal_mask>(x, y, count);
+}
+
+__attribute__((target("sse2")))
+static void
+sse2_fill(
+	tty::Cell* const dst,
+	std::size_t const count,
+	tty::Cell const& cell
+) noexcept {
+	using period = fill_period<sizeof(__m128i)>;
+	tty::Cell cells[period::cells];
+	std::fill(cells, cells + period::cells, cell);
+	__m128i pattern[period::vectors];
+	for (std::size_t v = 0u; period::vectors > v; ++v) {
+		pattern[v] = _mm_loadu_si128(reinterpret_cast<__m128i const*>(cells) + v);
+	}
+	std::size_t index = 0u;
+	for (; count >= index + period::cells; index += period::cells) {
+		auto const out = reinterpret_cast<__m128i*>(dst + index);
+		for (std::size_t v = 0u; period::vectors > v; ++v) {
+			_mm_storeu_si128(out + v, pattern[v]);
+		}
+	}
+	std::fill(dst + index, dst + count, cell);
+}
+
+// AVX2
+
+__attribute__((target("avx2")))
+inline static std::uint64_t
+avx2_equal_lane(
+	unsigned char const* const x,
+	unsigned char const* const y,
+	unsigned const lane
+) {
+	__m256i const vx = _mm256_loadu_si256(
+		reinterpret_cast<__m256i const*>(x + (lane << 5u))
+	);
+	__m256i const vy = _mm256_loadu_si256(
+		reinterpret_cast<__m256i const*>(y + (lane << 5u))
+	);
+	return static_cast<std::uint64_t>(static_cast<std::uint32_t>(
+		_mm256_movemask_epi8(_mm256_cmpeq_epi8(vx, vy))
+	)) << (lane << 5u);
+}
+
+__attribute__((target("avx2")))
+static std::uint64_t
+avx2_equal_mask(
+	unsigned char const* const x,
+	unsigned char const* const y
+) {
+	return
+		avx2_equal_lane(x, y, 0u) |
+		avx2_equal_lane(x, y, 1u)
+	;
+}
+
+__attribute__((target("avx2")))
+static std::size_t
+avx2_find_differ(
+	tty::Cell const* const x,
+	tty::Cell const* const y,
+	std::size_t const count
+) noexcept {
+	return window_find_differ<avx2_equal_mask>(x, y, count);
+}
+
+__attribute__((target("avx2")))
+static std::size_t
+avx2_find_equal(
+	tty::Cell const* const x,
+	tty::Cell const* const y,
+	std::size_t const count
+) noexcept {
+	return window_find_equal<avx2_equal_mask>(x, y, count);
+}
+
+__attribute__((target("avx2")))
+static void
+avx2_fill(
+	tty::Cell* const dst,
+	std::size_t const count,
+	tty::Cell const& cell
+) noexcept {
+	using period = fill_period<sizeof(__m256i)>;
+	tty::Cell cells[period::cells];
+	std::fill(cells, cells + period::cells, cell);
+	__m256i pattern[period::vectors];
+	for (std::size_t v = 0u; period::vectors > v; ++v) {
+		pattern[v] = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(cells) + v);
+	}
+	std::size_t index = 0u;
+	for (; count >= index + period::cells; index += period::cells) {
+		auto const out = reinterpret_cast<__m256i*>(dst + index);
+		for (std::size_t v = 0u; period::vectors > v; ++v) {
+			_mm256_storeu_si256(out + v, pattern[v]);
+		}
+	}
+	std::fill(dst + index, dst + count, cell);
+}
+
+#define BEARD_TTY_DIFF_X86_FUNCS_(name_) \
+	name_ ## _find_differ, name_ ## _find_equal, name_ ## _fill
+
+#else
+
+#define BEARD_TTY_DIFF_X86_FUNCS_(name_) \
+	scalar_find_differ, scalar_find_equal, scalar_fill
+
+#endif // BEARD_TTY_DIFF_X86
+
+static tty::DiffKernel const
+s_kernels[]{
+	{
+		tty::DiffImpl::scalar, "scalar",
+		scalar_find_differ, scalar_find_equal, scalar_fill
+	},
+	{tty::DiffImpl::sse2, "sse2", BEARD_TTY_DIFF_X86_FUNCS_(sse2)},
+	{tty::DiffImpl::avx2, "avx2", BEARD_TTY_DIFF_X86_FUNCS_(avx2)},
+};
+
+#undef BEARD_TTY_DIFF_X86_FUNCS_
+
+static_assert(
+	enum_cast(tty::DiffImpl::COUNT)
+	== std::extent<decltype(s_kernels)>::value,
+	"s_kernels is not the correct size"
+);
+
+} // anonymous namespace
+
+bool
+diff_supported(
+	tty::DiffImpl const impl
+) noexcept {
+#ifdef BEARD_TTY_DIFF_X86
+	__builtin_cpu_init();
+#endif
+	switch (impl) {
+	case tty::DiffImpl::scalar:
+		return true;
+
+#ifdef BEARD_TTY_DIFF_X86
+	case tty::DiffImpl::sse2:
+		return __builtin_cpu_supports("sse2");
+
+	case tty::DiffImpl::avx2:
+		return __builtin_cpu_supports("avx2");
+#endif
+
+	default:
+		return false;
+	}
+}
+
+tty::DiffKernel const&
+diff_kernel(
+	tty::DiffImpl const impl
+) noexcept {
+	return s_kernels[enum_cast(impl)];
+}
+
+tty::DiffKernel const&
+diff_kernel() noexcept {
+	static tty::DiffKernel const* const s_best = []() noexcept {
+		unsigned impl = enum_cast(tty::DiffImpl::COUNT);
+		do {
+			--impl;
+		} while (!diff_supported(static_cast<tty::DiffImpl>(impl)));
+		return &s_kernels[impl];
+	}();
+	return *s_best;
+}
+
+} // namespace tty
+} // namespace Beard
@@ -0,0 +1,733 @@
+/**
+@copyright MIT license; see @ref index or the accompanying LICENSE file.
+*/
+
+#include <Beard/config.hpp>
+#include <Beard/utility.hpp>
+#include <Beard/tty/Parm.hpp>
+
+#include <cstdint>
+#include <limits>
+
+namespace Beard {
+namespace tty {
+
+namespace {
+
+enum class OpCode : std::uint8_t {
+	// flags units of text at arg
+	text = 0u,
+	// Push parameter arg
+	push_param,
+	// Push constant arg
+	push_constant,
+	// Pop into variable arg
+	set_var,
+	// Push variable arg
+	get_var,
+	// %i
+	increment,
+	// %l
+	length,
+
+	// Write parameter arg as %d
+	write_param,
+
+	// Pop and write
+	write_char,
+	write_d,
+	write_o,
+	write_x,
+	write_X,
+
+	// Pop two operands, push the result
+	add,
+	sub,
+	mul,
+	div,
+	mod,
+	bit_and,
+	bit_or,
+	bit_xor,
+	equal,
+	greater,
+	less,
+	logical_and,
+	logical_or,
+
+	// Pop one operand, push the result
+	logical_not,
+	bit_not,
+
+	// Jump to arg if the popped value is 0
+	jump_zero,
+	// Jump to arg
+	jump,
+};
+
+enum : unsigned {
+	// Format flags
+	format_left = bit(0u),
+	format_sign = bit(1u),
+	format_alt = bit(2u),
+	format_space = bit(3u),
+	format_zero = bit(4u),
+	format_precision = bit(5u),
+
+	text_max_size = 0xFFu,
+	format_field_max = 0xFFu,
+	// Longest formatted value without width or precision: the
+	// octal digits of 2^32 - 1 with a prefix
+	format_value_max_size = 12u,
+
+	var_count = 2u * 26u,
+	ops_max = 0xFFFFu,
+};
+
+inline static constexpr bool
+is_digit(
+	char const c
+) noexcept {
+	return '0' <= c && '9' >= c;
+}
+
+// Variable index for a..z (dynamic) or A..Z (static); var_count if
+// c is neither
+inline static constexpr unsigned
+var_index(
+	char const c
+) noexcept {
+	return
+		  ('a' <= c && 'z' >= c) ? unsigned_cast(c - 'a')
+		: ('A' <= c && 'Z' >= c) ? 26u + unsigned_cast(c - 'A')
+		: var_count
+	;
+}
+
+// Binary and unary operations by operator
+static OpCode
+operator_code(
+	char const c,
+	bool& found
+) noexcept {
+	found = true;
+	switch (c) {
+	case '+': return OpCode::add;
+	case '-': return OpCode::sub;
+	case '*': return OpCode::mul;
+	case '/': return OpCode::div;
+	case 'm': return OpCode::mod;
+	case '&': return OpCode::bit_and;
+	case '|': return OpCode::bit_or;
+	case '^': return OpCode::bit_xor;
+	case '=': return OpCode::equal;
+	case '>': return OpCode::greater;
+	case '<': return OpCode::less;
+	case 'A': return OpCode::logical_and;
+	case 'O': return OpCode::logical_or;
+	case '!': return OpCode::logical_not;
+	case '~': return OpCode::bit_not;
+	default:
+		found = false;
+		return OpCode::text;
+	}
+}
+
+// Encode magnitude in base to the end of buffer; returns the first
+// digit. The base is constant so that the division is a multiply.
+template<unsigned base>
+inline static char*
+encode_digits(
+	char* it,
+	unsigned magnitude,
+	char const* const digit_chars
+) noexcept {
+	do {
+		*--it = digit_chars[magnitude % base];
+		magnitude /= base;
+	} while (0u != magnitude);
+	return it;
+}
+
+// Write value as %d into it; returns the end of the output
+inline static char*
+write_decimal(
+	char* it,
+	ParmProgram::value_type const value
+) noexcept {
+	unsigned magnitude = static_cast<unsigned>(value);
+	if (0 > value) {
+		*it++ = '-';
+		magnitude = 0u - magnitude;
+	}
+	char digits[format_value_max_size];
+	char* const digits_end = digits + format_value_max_size;
+	char const* first
+		= encode_digits<10u>(digits_end, magnitude, "0123456789");
+	// Too short for a memcpy() call to pay off
+	for (; digits_end != first; ++first) {
+		*it++ = *first;
+	}
+	return it;
+}
+
+// Format value per printf into it; returns the end of the output
+static char*
+write_format(
+	char* it,
+	OpCode const code,
+	unsigned const flags,
+	unsigned const width,
+	unsigned const precision,
+	ParmProgram::value_type const value
+) noexcept {
+	char const* const digit_chars
+		= (OpCode::write_X == code)
+		? "0123456789ABCDEF"
+		: "0123456789abcdef"
+	;
+	bool const negative = OpCode::write_d == code && 0 > value;
+	unsigned magnitude = static_cast<unsigned>(value);
+	if (negative) {
+		magnitude = 0u - magnitude;
+	}
+
+	char digits[format_value_max_size];
+	char* const digits_end = digits + format_value_max_size;
+	char* first = digits_end;
+	// A precision of 0 formats 0 as nothing
+	if (0u != magnitude || !(flags & format_precision) || 0u != precision) {
+		switch (code) {
+		case OpCode::write_d:
+			first = encode_digits<10u>(digits_end, magnitude, digit_chars);
+			break;
+		case OpCode::write_o:
+			first = encode_digits<8u>(digits_end, magnitude, digit_chars);
+			break;
+		default:
+			first = encode_digits<16u>(digits_end, magnitude, digit_chars);
+			break;
+		}
+	}
+	unsigned const digit_count = unsigned_cast(digits_end - first);
+	unsigned const precision_zeros
+		= (flags & format_precision) && precision > digit_count
+		? precision - digit_count
+		: 0u
+	;
+
+	char prefix[2u];
+	unsigned prefix_size = 0u;
+	if (OpCode::write_d == code) {
+		if (negative) {
+			prefix[prefix_size++] = '-';
+		} else if (flags & format_sign) {
+			prefix[prefix_size++] = '+';
+		} else if (flags & format_space) {
+			prefix[prefix_size++] = ' ';
+		}
+	} else if (flags & format_alt) {
+		if (OpCode::write_o == code) {
+			if (0u == precision_zeros && ('0' != *first || 0u == digit_count)) {
+				prefix[prefix_size++] = '0';
+			}
+		} else if (0 != value) {
+			prefix[prefix_size++] = '0';
+			prefix[prefix_size++] = (OpCode::write_X == code) ? 'X' : 'x';
+		}
+	}
+
+	unsigned const size = prefix_size + precision_zeros + digit_count;
+	unsigned pad = width > size ? width - size : 0u;
+	bool const zero_pad
+		= (flags & format_zero) &&
+		!(flags & (format_left | format_precision))
+	;
+	if (!(flags & format_left) && !zero_pad) {
+		for (; 0u < pad; --pad) {
+			*it++ = ' ';
+		}
+	}
+	for (unsigned idx = 0u; prefix_size > idx; ++idx) {
+		*it++ = prefix[idx];
+	}
+	if (zero_pad) {
+		for (; 0u < pad; --pad) {
+			*it++ = '0';
+		}
+	}
+	for (unsigned idx = 0u; precision_zeros > idx; ++idx) {
+		*it++ = '0';
+	}
+	for (; digits_end != first; ++first) {
+		*it++ = *first;
+	}
+	for (; 0u < pad; --pad) {
+		*it++ = ' ';
+	}
+	return it;
+}
+
+} // anonymous namespace
+
+// class ParmProgram implementation
+
+#define BEARD_SCOPE_CLASS tty::ParmProgram
+
+ParmProgram::~ParmProgram() noexcept = default;
+
+ParmProgram::ParmProgram() noexcept
+	: m_ops()
+	, m_text()
+	, m_constants()
+	, m_max_size(0u)
+{}
+
+ParmProgram::ParmProgram(ParmProgram&&) noexcept = default;
+ParmProgram::ParmProgram(ParmProgram const&) = default;
+ParmProgram& ParmProgram::operator=(ParmProgram&&) noexcept = default;
+ParmProgram& ParmProgram::operator=(ParmProgram const&) = default;
+
+void
+ParmProgram::clear() noexcept {
+	m_ops.clear();
+	m_text.clear();
+	m_constants.clear();
+	m_max_size = 0u;
+}
+
+bool
+ParmProgram::compile(
+	String const& str
+) {
+	clear();
+
+	// Conditional being compiled: the jump_zero of the last %t, which
+	// goes to the next %e or the %;, and the first of the jumps at
+	// each %e, which go to the %;
+	struct Conditional final {
+		signed then_jump;
+		std::size_t first_end_jump;
+	};
+	aux::vector<Conditional> conditionals{};
+	aux::vector<std::size_t> end_jumps{};
+	// Whether the last op can be merged with the next one. This is
+	// false after a jump target is set so that the target doesn't
+	// skip the merged op.
+	bool last_open = false;
+
+	auto const emit = [this, &last_open](
+		OpCode const code,
+		unsigned const flags,
+		unsigned const arg
+	) {
+		m_ops.push_back({
+			static_cast<std::uint8_t>(code),
+			static_cast<std::uint8_t>(flags),
+			static_cast<std::uint16_t>(arg)
+		});
+		last_open = OpCode::push_param == code;
+	};
+	auto const emit_text = [this, &last_open](
+		char const c
+	) {
+		if (
+			last_open &&
+			enum_cast(OpCode::text) == m_ops.back().code &&
+			text_max_size > m_ops.back().flags
+		) {
+			++m_ops.back().flags;
+		} else {
+			m_ops.push_back({
+				static_cast<std::uint8_t>(OpCode::text),
+				1u,
+				static_cast<std::uint16_t>(m_text.size())
+			});
+			last_open = true;
+		}
+		m_text.push_back(c);
+		++m_max_size;
+	};
+	auto const emit_constant = [this, &emit](
+		value_type const value
+	) {
+		emit(OpCode::push_constant, 0u, unsigned_cast(m_constants.size()));
+		m_constants.push_back(value);
+	};
+	auto const patch = [this, &last_open](
+		std::size_t const op
+	) {
+		m_ops[op].arg = static_cast<std::uint16_t>(m_ops.size());
+		last_open = false;
+	};
+	auto const close_conditional = [&conditionals, &end_jumps, &patch]() {
+		if (-1 != conditionals.back().then_jump) {
+			patch(unsigned_cast(conditionals.back().then_jump));
+		}
+		for (
+			auto idx = conditionals.back().first_end_jump;
+			end_jumps.size() > idx;
+			++idx
+		) {
+			patch(end_jumps[idx]);
+		}
+		end_jumps.resize(conditionals.back().first_end_jump);
+		conditionals.pop_back();
+	};
+	auto const fail = [this]() -> bool {
+		clear();
+		return false;
+	};
+
+	auto it = str.cbegin();
+	auto const end = str.cend();
+	while (end != it) {
+		if (ops_max <= m_ops.size() || 0xFFFFu <= m_text.size()) {
+			return fail();
+		}
+		char const c = *it++;
+		if ('$' == c && end != it && '<' == *it) {
+			// Delay; written as text if it isn't one
+			auto delay_end = it + 1;
+			for (
+				;
+				end != delay_end && (
+					is_digit(*delay_end) ||
+					'.' == *delay_end ||
+					'*' == *delay_end ||
+					'/' == *delay_end
+				);
+				++delay_end
+			) {}
+			if (end != delay_end && '>' == *delay_end) {
+				it = delay_end + 1;
+			} else {
+				emit_text(c);
+			}
+			continue;
+		} else if ('%' != c) {
+			emit_text(c);
+			continue;
+		} else if (end == it) {
+			return fail();
+		}
+
+		char const op = *it++;
+		bool is_operator = false;
+		OpCode const operator_op = operator_code(op, is_operator);
+		if (is_operator) {
+			emit(operator_op, 0u, 0u);
+			continue;
+		}
+		switch (op) {
+		case '%':
+			emit_text('%');
+			break;
+
+		case 'c':
+			emit(OpCode::write_char, 0u, 0u);
+			++m_max_size;
+			break;
+
+		case 'p':
+			if (end == it || '1' > *it || '9' < *it) {
+				return fail();
+			}
+			emit(OpCode::push_param, 0u, unsigned_cast(*it++ - '1'));
+			break;
+
+		case 'P':
+		case 'g':
+			if (end == it || var_count == var_index(*it)) {
+				return fail();
+			}
+			emit(
+				'P' == op ? OpCode::set_var : OpCode::get_var,
+				0u, var_index(*it++)
+			);
+			break;
+
+		case '\'':
+			if (end == it || end == it + 1 || '\'' != *(it + 1)) {
+				return fail();
+			}
+			emit_constant(static_cast<unsigned char>(*it));
+			it += 2;
+			break;
+
+		case '{': {
+			bool const negative = end != it && '-' == *it;
+			if (negative) {
+				++it;
+			}
+			std::int64_t value = 0;
+			auto const first = it;
+			for (; end != it && is_digit(*it); ++it) {
+				value = min_ce<std::int64_t>(
+					value * 10 + (*it - '0'),
+					std::numeric_limits<value_type>::max()
+				);
+			}
+			if (first == it || end == it || '}' != *it) {
+				return fail();
+			}
+			++it;
+			emit_constant(static_cast<value_type>(negative ? -value : value));
+		}	break;
+
+		case 'l':
+			emit(OpCode::length, 0u, 0u);
+			break;
+
+		case 'i':
+			emit(OpCode::increment, 0u, 0u);
+			break;
+
+		case '?':
+			conditionals.push_back({-1, end_jumps.size()});
+			break;
+
+		case 't':
+			if (conditionals.empty()) {
+				return fail();
+			}
+			conditionals.back().then_jump = signed_cast(m_ops.size());
+			emit(OpCode::jump_zero, 0u, 0u);
+			break;
+
+		case 'e':
+			if (conditionals.empty()) {
+				return fail();
+			}
+			end_jumps.push_back(m_ops.size());
+			emit(OpCode::jump, 0u, 0u);
+			if (-1 != conditionals.back().then_jump) {
+				patch(unsigned_cast(conditionals.back().then_jump));
+				conditionals.back().then_jump = -1;
+			}
+			break;
+
+		case ';':
+			if (conditionals.empty()) {
+				return fail();
+			}
+			close_conditional();
+			break;
+
+		default: {
+			// %[[:]flags][width[.precision]][doxXs]
+			--it;
+			unsigned flags = 0u;
+			bool const colon = ':' == *it;
+			if (colon) {
+				++it;
+			}
+			for (; end != it; ++it) {
+				if ('#' == *it) {
+					flags |= format_alt;
+				} else if (' ' == *it) {
+					flags |= format_space;
+				} else if (colon && '-' == *it) {
+					flags |= format_left;
+				} else if (colon && '+' == *it) {
+					flags |= format_sign;
+				} else {
+					break;
+				}
+			}
+			if (end != it && '0' == *it) {
+				flags |= format_zero;
+			}
+			unsigned width = 0u;
+			for (; end != it && is_digit(*it); ++it) {
+				width = min_ce(width * 10u + unsigned_cast(*it - '0'), 0xFFFFu);
+			}
+			unsigned precision = 0u;
+			if (end != it && '.' == *it) {
+				flags |= format_precision;
+				for (++it; end != it && is_digit(*it); ++it) {
+					precision = min_ce(
+						precision * 10u + unsigned_cast(*it - '0'), 0xFFFFu
+					);
+				}
+			}
+			if (
+				end == it ||
+				format_field_max < width ||
+				format_field_max < precision
+			) {
+				return fail();
+			}
+			OpCode code;
+			switch (*it++) {
+			case 'd': case 's': code = OpCode::write_d; break;
+			case 'o': code = OpCode::write_o; break;
+			case 'x': code = OpCode::write_x; break;
+			case 'X': code = OpCode::write_X; break;
+			default:
+				return fail();
+			}
+			if (
+				OpCode::write_d == code &&
+				0u == flags && 0u == width &&
+				last_open &&
+				enum_cast(OpCode::push_param) == m_ops.back().code
+			) {
+				// %pN%d
+				m_ops.back().code = enum_cast(OpCode::write_param);
+				last_open = false;
+			} else {
+				emit(code, flags, width | (precision << 8u));
+			}
+			m_max_size += max_ce(
+				std::size_t{width},
+				std::size_t{max_ce(precision, 11u) + 2u}
+			);
+		}	break;
+		}
+	}
+	// Unterminated conditionals end with the string
+	while (!conditionals.empty()) {
+		close_conditional();
+	}
+	if (ops_max < m_ops.size()) {
+		return fail();
+	}
+	return true;
+}
+
+std::size_t
+ParmProgram::evaluate(
+	char* const buffer,
+	value_type const* const params,
+	unsigned const count
+) const noexcept {
+	value_type p[max_params]{};
+	for (unsigned idx = 0u; min_ce(count, unsigned{max_params}) > idx; ++idx) {
+		p[idx] = params[idx];
+	}
+	// Variables are 0 until set; the mask saves clearing them
+	value_type vars[var_count];
+	std::uint64_t vars_set = 0u;
+	value_type stack[stack_size];
+	unsigned top = 0u;
+	auto const push = [&stack, &top](value_type const value) {
+		if (stack_size > top) {
+			stack[top++] = value;
+		}
+	};
+	auto const pop = [&stack, &top]() -> value_type {
+		return 0u < top ? stack[--top] : 0;
+	};
+
+	// Output can alias anything, so the members are loaded once
+	Op const* const ops = m_ops.data();
+	std::size_t const ops_size = m_ops.size();
+	char const* const text = m_text.data();
+	value_type const* const constants = m_constants.data();
+
+	char* it = buffer;
+	value_type x, y;
+	for (std::size_t pc = 0u; ops_size > pc;) {
+		Op const op = ops[pc++];
+		switch (static_cast<OpCode>(op.code)) {
+		case OpCode::text: {
+			// Usually too short for a memcpy() call to pay off
+			char const* const text_end = text + op.arg + op.flags;
+			for (char const* unit = text + op.arg; text_end != unit; ++unit) {
+				*it++ = *unit;
+			}
+		}	break;
+
+		case OpCode::push_param: push(p[op.arg]); break;
+		case OpCode::push_constant: push(constants[op.arg]); break;
+		case OpCode::set_var:
+			vars[op.arg] = pop();
+			vars_set |= std::uint64_t{1u} << op.arg;
+			break;
+
+		case OpCode::get_var:
+			push((vars_set & (std::uint64_t{1u} << op.arg)) ? vars[op.arg] : 0);
+			break;
+
+		case OpCode::increment: ++p[0u]; ++p[1u]; break;
+		case OpCode::length: pop(); push(0); break;
+
+		case OpCode::write_char:
+			// NUL is written as 0200 like ncurses, which some terminals
+			// take as 0 when they ignore the high bit
+			x = pop();
+			*it++ = static_cast<char>(0 == x ? 0200 : x);
+			break;
+
+		case OpCode::write_param:
+			it = write_decimal(it, p[op.arg]);
+			break;
+
+		case OpCode::write_d:
+		case OpCode::write_o:
+		case OpCode::write_x:
+		case OpCode::write_X:
+			it = write_format(
+				it,
+				static_cast<OpCode>(op.code),
+				op.flags,
+				op.arg & 0xFFu,
+				op.arg >> 8u,
+				pop()
+			);
+			break;
+
+		// Operations wrap like the unsigned arithmetic they are
+		// done in
+		#define BEARD_TTY_PARM_BINARY_(code_, expr_)	\
+			case OpCode:: code_:						\
+				y = pop(); x = pop(); push(expr_);		\
+				break;
+		BEARD_TTY_PARM_BINARY_(add, static_cast<value_type>(
+			static_cast<std::uint32_t>(x) + static_cast<std::uint32_t>(y)
+		))
+		BEARD_TTY_PARM_BINARY_(sub, static_cast<value_type>(
+			static_cast<std::uint32_t>(x) - static_cast<std::uint32_t>(y)
+		))
+		BEARD_TTY_PARM_BINARY_(mul, static_cast<value_type>(
+			static_cast<std::uint32_t>(x) * static_cast<std::uint32_t>(y)
+		))
+		BEARD_TTY_PARM_BINARY_(div,
+			(0 == y || (-1 == y && std::numeric_limits<value_type>::min() == x))
+			? 0 : x / y
+		)
+		BEARD_TTY_PARM_BINARY_(mod,
+			(0 == y || -1 == y) ? 0 : x % y
+		)
+		BEARD_TTY_PARM_BINARY_(bit_and, x & y)
+		BEARD_TTY_PARM_BINARY_(bit_or, x | y)
+		BEARD_TTY_PARM_BINARY_(bit_xor, x ^ y)
+		BEARD_TTY_PARM_BINARY_(equal, x == y)
+		BEARD_TTY_PARM_BINARY_(greater, x > y)
+		BEARD_TTY_PARM_BINARY_(less, x < y)
+		BEARD_TTY_PARM_BINARY_(logical_and, 0 != x && 0 != y)
+		BEARD_TTY_PARM_BINARY_(logical_or, 0 != x || 0 != y)
+		#undef BEARD_TTY_PARM_BINARY_
+
+		case OpCode::logical_not: push(0 == pop()); break;
+		case OpCode::bit_not: push(~pop()); break;
+
+		case OpCode::jump_zero:
+			if (0 == pop()) {
+				pc = op.arg;
+			}
+			break;
+
+		case OpCode::jump:
+			pc = op.arg;
+			break;
+		}
+	}
+	return unsigned_cast(it - buffer);
+}
+
+#undef BEARD_SCOPE_CLASS
+
+} // namespace tty
+} // namespace Beard
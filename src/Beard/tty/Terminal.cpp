@@ -6,8 +6,11 @@
 #include <Beard/keys.hpp>
 #include <Beard/utility.hpp>
 #include <Beard/txt/Defs.hpp>
+#include <Beard/txt/UTF8.hpp>
 #include <Beard/tty/Defs.hpp>
 #include <Beard/tty/Caps.hpp>
+#include <Beard/tty/Diff.hpp>
+#include <Beard/tty/Parm.hpp>
 #include <Beard/tty/Terminal.hpp>
 
 #include <duct/traits.hpp>
@@ -59,13 +62,15 @@ struct Terminal::terminal_private final {
 };
 
 namespace {
-enum : unsigned {
-	attr_mask = 0xFF00,
-	attr_mask_color = 0x00FF,
-};
 
 static tty::Terminal* s_sigwinch_terminal{nullptr};
 
+// Synchronized update mode (DEC private mode 2026) query and the
+// prefix of its DECRPM reply, which ends with "<value>$y"
+static constexpr char const
+s_sync_query[] = "\033[?2026$p",
+s_sync_report_prefix[] = "\033[?2026;";
+
 static tty::CapString const
 s_cap_cache_table[]{
 	tty::CapString::clear_screen,
@@ -84,6 +89,24 @@ s_cap_cache_table[]{
 
 	tty::CapString::keypad_local,
 	tty::CapString::keypad_xmit,
+
+	tty::CapString::carriage_return,
+	tty::CapString::cursor_down,
+	tty::CapString::cursor_right,
+
+	tty::CapString::scroll_forward,
+	tty::CapString::scroll_reverse,
+	tty::CapString::insert_line,
+	tty::CapString::delete_line,
+};
+
+static tty::CapString const
+s_parm_table[]{
+	tty::CapString::cursor_address,
+	tty::CapString::parm_right_cursor,
+	tty::CapString::set_a_foreground,
+	tty::CapString::set_a_background,
+	tty::CapString::change_scroll_region,
 };
 
 // D:
@@ -176,6 +199,78 @@ static struct {
 };
 
 #undef BEARD_TTY_IKM_CURSOR_
+
+enum : unsigned {
+	sgr_bold		= bit(0u),
+	sgr_underline	= bit(1u),
+	sgr_blink		= bit(2u),
+	sgr_reverse		= bit(3u),
+
+	sgr_flag_count = 4u,
+	sgr_max_size = 64u,
+};
+
+enum : unsigned {
+	palette_size = 256u,
+	palette_cube_first = 16u,
+	palette_gray_first = 232u,
+	palette_gray_count = 24u,
+	// RGB colors are reduced through a table indexed by the high
+	// bits of each component
+	rgb_table_bits = 5u,
+	rgb_table_size = 1u << (3u * rgb_table_bits),
+	// Number of colors at which RGB colors are written directly
+	direct_color_count = 0x1000000u,
+};
+
+// xterm's default basic and bright colors; the rest of the palette
+// is a color cube and a grayscale ramp
+static std::uint8_t const
+s_palette_basic[16u][3u]{
+	{0x00, 0x00, 0x00}, {0xCD, 0x00, 0x00}, {0x00, 0xCD, 0x00}, {0xCD, 0xCD, 0x00},
+	{0x00, 0x00, 0xEE}, {0xCD, 0x00, 0xCD}, {0x00, 0xCD, 0xCD}, {0xE5, 0xE5, 0xE5},
+	{0x7F, 0x7F, 0x7F}, {0xFF, 0x00, 0x00}, {0x00, 0xFF, 0x00}, {0xFF, 0xFF, 0x00},
+	{0x5C, 0x5C, 0xFF}, {0xFF, 0x00, 0xFF}, {0x00, 0xFF, 0xFF}, {0xFF, 0xFF, 0xFF},
+};
+
+// Component levels of the 6x6x6 color cube
+static unsigned const
+s_cube_levels[6u]{0x00, 0x5F, 0x87, 0xAF, 0xD7, 0xFF};
+
+// Nearest-color lookup tables for reducing colors to what the
+// terminal can display
+struct ColorTables final {
+	// Nearest of the first 8 and 16 palette colors to each palette
+	// color
+	std::uint8_t index_to_8[palette_size];
+	std::uint8_t index_to_16[palette_size];
+	// Nearest cube or grayscale palette color to each reduced RGB
+	// color
+	std::uint8_t rgb_to_index[rgb_table_size];
+};
+
+// Two-digit decimal pairs for 00 through 99
+static char const
+s_decimal_pairs[]{
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899"
+};
+
+// SGR parameters to enable and disable each flag, by flag index
+static char const* const
+s_sgr_param_on[sgr_flag_count]{"1", "4", "5", "7"};
+
+static char const* const
+s_sgr_param_off[sgr_flag_count]{"22", "24", "25", "27"};
+
 } // anonymous namespace
 
 struct terminal_internal final
@@ -188,6 +283,12 @@ static_assert(
 	"s_cap_cache_table is not the correct size"
 );
 
+static_assert(
+	std::extent<decltype(s_parm_table)>::value
+	== static_cast<std::size_t>(Terminal::ParmCap::COUNT),
+	"s_parm_table is not the correct size"
+);
+
 using KeyDecodeNode = tty::Terminal::KeyDecodeNode;
 
 #define BEARD_SCOPE_FUNC internal::close_fd
@@ -351,13 +452,167 @@ static void
 clear_buffer(
 	tty::Terminal::cell_vector_type& cell_buffer,
 	tty::Cell const& cell = tty::s_cell_default
+) noexcept {
+	tty::diff_kernel().fill(cell_buffer.data(), cell_buffer.size(), cell);
+}
+
+// Blank the half of a wide cell split at column x of row: a wide
+// cell at x - 1 without its continuation cell at x, or a continuation
+// cell at x without a wide cell at x - 1. Returns the column of the
+// blanked cell, or -1 if nothing was split.
+static geom_value_type
+repair_wide_split(
+	tty::Cell* const row,
+	geom_value_type const width,
+	geom_value_type const x
+) noexcept {
+	bool const wide = 0 < x && 2u == tty::cell_width(row[x - 1]);
+	bool const continued = width > x && tty::is_continuation(row[x]);
+	if (wide == continued) {
+		return -1;
+	}
+	geom_value_type const blanked = wide ? x - 1 : x;
+	row[blanked].u8block.assign(' ');
+	return blanked;
+}
+
+// repair_wide_split() on row y of the back buffer, marking the
+// blanked cell dirty
+static void
+repair_back_split(
+	Terminal& terminal,
+	geom_value_type const y,
+	geom_value_type const x
+) noexcept {
+	geom_value_type const width = terminal.m_tty_size.width;
+	geom_value_type const blanked = repair_wide_split(
+		terminal.m_cell_backbuffer.data() + y * width, width, x
+	);
+	if (0 <= blanked) {
+		terminal.m_dirty_rows[y].add(blanked, blanked + 1);
+		terminal.m_states.enable(Terminal::State::backbuffer_dirty);
+	}
+}
+
+// Index of the stored cluster a cell refers to
+inline static std::uint32_t
+cluster_index(
+	tty::Cell const& cell
+) noexcept {
+	auto const units
+		= reinterpret_cast<unsigned char const*>(cell.u8block.units);
+	return
+		  (std::uint32_t{units[1u] & 0x7Fu} << 16u)
+		| (std::uint32_t{units[2u]} << 8u)
+		| std::uint32_t{units[3u]}
+	;
+}
+
+// Code units of the cluster of a cell that isn't a continuation cell
+inline static txt::Sequence
+cell_units(
+	Terminal const& terminal,
+	tty::Cell const& cell
+) noexcept {
+	if (tty::is_cluster_ref(cell)) {
+		auto const& cluster = *terminal.m_clusters[cluster_index(cell)];
+		return {cluster.data(), cluster.size()};
+	}
+	return {cell.u8block.units, cell.u8block.size()};
+}
+
+// Make a cell refer to a stored cluster
+inline static void
+set_cluster_ref(
+	tty::Cell& cell,
+	bool const wide,
+	std::uint32_t const index
+) noexcept {
+	auto& block = cell.u8block.units;
+	block[0u] = tty::cluster_ref_unit;
+	block[1u] = static_cast<char>((wide ? 0x80u : 0u) | (index >> 16u));
+	block[2u] = static_cast<char>((index >> 8u) & 0xFFu);
+	block[3u] = static_cast<char>(index & 0xFFu);
+}
+
+// Drop the stored clusters that no cell in either buffer refers to
+// and renumber the rest
+static void
+compact_clusters(
+	Terminal& terminal
 ) {
-	// TODO: Optimize with cache buffer of constant size and std::copy()?
-	std::fill(
-		cell_buffer.begin(),
-		cell_buffer.end(),
-		cell
+	Terminal::cluster_map_type map{};
+	Terminal::cluster_vector_type clusters{};
+	auto const renumber = [&terminal, &map, &clusters](
+		Terminal::cell_vector_type& buffer
+	) {
+		for (auto& cell : buffer) {
+			if (!tty::is_cluster_ref(cell)) {
+				continue;
+			}
+			auto const& cluster = *terminal.m_clusters[cluster_index(cell)];
+			auto it = map.find(cluster);
+			if (map.end() == it) {
+				it = map.emplace(
+					cluster, static_cast<std::uint32_t>(clusters.size())
+				).first;
+				clusters.push_back(&it->first);
+			}
+			set_cluster_ref(cell, 2u == tty::cell_width(cell), it->second);
+		}
+	};
+	renumber(terminal.m_cell_frontbuffer);
+	renumber(terminal.m_cell_backbuffer);
+	terminal.m_cluster_map = std::move(map);
+	terminal.m_clusters = std::move(clusters);
+	// Live clusters are bounded by the number of cells, so the
+	// table is compacted long before indexes run out
+	terminal.m_cluster_compact_at = min_ce(
+		max_ce(
+			std::size_t{Terminal::cluster_compact_min},
+			2u * terminal.m_clusters.size()
+		),
+		std::size_t{Terminal::cluster_index_max} + 1u
 	);
+	// Rows with clusters have new cell values
+	invalidate_front_hashes(terminal, 0, terminal.m_tty_size.height);
+}
+
+// Append a code unit sequence to the cluster of a cell taking
+// columns, storing the cluster if it doesn't fit in the block.
+// Returns false if no more clusters can be stored.
+static bool
+append_cluster(
+	Terminal& terminal,
+	tty::Cell& cell,
+	unsigned const columns,
+	txt::EncUtils::char_type const* const data,
+	std::size_t const size
+) {
+	if (!tty::is_cluster_ref(cell) && cell.u8block.append(data, size)) {
+		return true;
+	}
+	auto const units = cell_units(terminal, cell);
+	String cluster{units.data, units.size};
+	cluster.append(data, size);
+	auto it = terminal.m_cluster_map.find(cluster);
+	if (terminal.m_cluster_map.end() == it) {
+		if (terminal.m_cluster_compact_at <= terminal.m_clusters.size()) {
+			// The cell is rewritten below, so its current cluster
+			// can be renumbered or dropped
+			compact_clusters(terminal);
+		}
+		std::size_t const index = terminal.m_clusters.size();
+		if (Terminal::cluster_index_max < index) {
+			return false;
+		}
+		it = terminal.m_cluster_map.emplace(
+			std::move(cluster), static_cast<std::uint32_t>(index)
+		).first;
+		terminal.m_clusters.push_back(&it->first);
+	}
+	set_cluster_ref(cell, 2u == columns, it->second);
+	return true;
 }
 
 static void
@@ -382,6 +637,8 @@ resize_buffer(
 			auto it_new = newb.begin();
 			for (geom_value_type y = 0; min_height > y; ++y) {
 				std::copy(it_old, it_old + min_width, it_new);
+				// A wide cell may have lost its continuation cell
+				repair_wide_split(&*it_new, new_width, min_width);
 				it_old += old_width;
 				it_new += new_width;
 			}
@@ -393,158 +650,1701 @@ resize_buffer(
 	}
 }
 
+// Shift the rows of rect up by lines (down if negative) and clear
+// the exposed rows; rect must be within the buffer and lines must be
+// smaller than its height
+static void
+shift_rows(
+	tty::Terminal::cell_vector_type& cell_buffer,
+	geom_value_type const width,
+	Rect const& rect,
+	geom_value_type const lines
+) noexcept {
+	auto const row_cells = unsigned_cast(rect.size.width);
+	auto const base
+		= cell_buffer.data()
+		+ (rect.pos.y * width)
+		+ rect.pos.x
+	;
+	geom_value_type const count = (0 > lines) ? -lines : lines;
+	geom_value_type const kept = rect.size.height - count;
+	tty::Cell* exposed;
+	if (0 < lines) {
+		for (geom_value_type row = 0; kept > row; ++row) {
+			auto const src = base + (row + count) * width;
+			std::copy(src, src + row_cells, base + row * width);
+		}
+		exposed = base + kept * width;
+	} else {
+		for (geom_value_type row = kept; 0 < row--;) {
+			auto const src = base + row * width;
+			std::copy(src, src + row_cells, base + (row + count) * width);
+		}
+		exposed = base;
+	}
+	auto const& kernel = tty::diff_kernel();
+	for (geom_value_type row = 0; count > row; ++row) {
+		kernel.fill(exposed + row * width, row_cells, tty::s_cell_default);
+	}
+}
+
+// row hashing
+
+static constexpr std::uint64_t const
+s_hash_prime1 = 0x9E3779B185EBCA87u,
+s_hash_prime2 = 0xC2B2AE3D27D4EB4Fu;
+
+inline static std::uint64_t
+hash_round(
+	std::uint64_t acc,
+	unsigned char const* const data
+) noexcept {
+	std::uint64_t word;
+	std::memcpy(&word, data, sizeof(word));
+	acc = (acc ^ word) * s_hash_prime1;
+	return (acc << 31u) | (acc >> 33u);
+}
+
+// Hash a row of cells as 64-bit words; four independent lanes keep
+// the multiplies from serializing
+static std::uint64_t
+hash_row(
+	tty::Cell const* const row,
+	std::size_t const count
+) noexcept {
+	enum : std::size_t {
+		word_size = sizeof(std::uint64_t),
+	};
+	auto const data = reinterpret_cast<unsigned char const*>(row);
+	std::size_t const size = count * sizeof(tty::Cell);
+	std::uint64_t lanes[4u]{
+		s_hash_prime1, s_hash_prime2, ~s_hash_prime1, ~s_hash_prime2
+	};
+	std::size_t index = 0u;
+	for (; size >= index + 4u * word_size; index += 4u * word_size) {
+		lanes[0u] = hash_round(lanes[0u], data + index + 0u * word_size);
+		lanes[1u] = hash_round(lanes[1u], data + index + 1u * word_size);
+		lanes[2u] = hash_round(lanes[2u], data + index + 2u * word_size);
+		lanes[3u] = hash_round(lanes[3u], data + index + 3u * word_size);
+	}
+	std::uint64_t hash = count;
+	for (; size >= index + word_size; index += word_size) {
+		hash = hash_round(hash, data + index);
+	}
+	if (size != index) {
+		unsigned char tail[word_size]{};
+		std::memcpy(tail, data + index, size - index);
+		hash = hash_round(hash, tail);
+	}
+	for (auto const lane : lanes) {
+		hash = (hash ^ lane) * s_hash_prime1;
+	}
+	hash ^= hash >> 29u;
+	hash *= s_hash_prime2;
+	return hash ^ (hash >> 32u);
+}
+
+static void
+invalidate_front_hashes(
+	Terminal& terminal,
+	geom_value_type const top,
+	geom_value_type const bottom
+) noexcept {
+	for (geom_value_type y = top; bottom > y; ++y) {
+		terminal.m_row_hashes[y].front_valid = false;
+	}
+}
+
+// colors
+
+static void
+palette_rgb(
+	unsigned const index,
+	unsigned (&rgb)[3u]
+) noexcept {
+	if (palette_cube_first > index) {
+		for (unsigned c = 0u; 3u > c; ++c) {
+			rgb[c] = s_palette_basic[index][c];
+		}
+	} else if (palette_gray_first > index) {
+		unsigned const cube = index - palette_cube_first;
+		rgb[0u] = s_cube_levels[cube / 36u];
+		rgb[1u] = s_cube_levels[(cube / 6u) % 6u];
+		rgb[2u] = s_cube_levels[cube % 6u];
+	} else {
+		rgb[0u] = rgb[1u] = rgb[2u] = 8u + 10u * (index - palette_gray_first);
+	}
+}
+
+static unsigned
+color_distance(
+	unsigned const (&x)[3u],
+	unsigned const (&y)[3u]
+) noexcept {
+	unsigned distance = 0u;
+	for (unsigned c = 0u; 3u > c; ++c) {
+		signed const d = signed_cast(x[c]) - signed_cast(y[c]);
+		distance += unsigned_cast(d * d);
+	}
+	return distance;
+}
+
+// Nearest palette color in [0, count) to rgb
+static std::uint8_t
+nearest_basic(
+	unsigned const (&rgb)[3u],
+	unsigned const count
+) noexcept {
+	unsigned best = 0u;
+	unsigned best_distance = ~0u;
+	unsigned candidate[3u];
+	for (unsigned index = 0u; count > index; ++index) {
+		palette_rgb(index, candidate);
+		unsigned const distance = color_distance(rgb, candidate);
+		if (best_distance > distance) {
+			best = index;
+			best_distance = distance;
+		}
+	}
+	return static_cast<std::uint8_t>(best);
+}
+
+static unsigned
+nearest_cube_level(
+	unsigned const value
+) noexcept {
+	unsigned level = 0u;
+	for (
+		;
+		5u > level &&
+		value * 2u > s_cube_levels[level] + s_cube_levels[level + 1u];
+		++level
+	) {}
+	return level;
+}
+
+static ColorTables
+make_color_tables() noexcept {
+	ColorTables tables;
+	unsigned rgb[3u];
+	for (unsigned index = 0u; palette_size > index; ++index) {
+		palette_rgb(index, rgb);
+		tables.index_to_8[index] = nearest_basic(rgb, 8u);
+		tables.index_to_16[index] = nearest_basic(rgb, 16u);
+	}
+
+	// The cube's components are independent, so its nearest color is
+	// per-component; the nearest gray is that of the average
+	unsigned const component_mask = (1u << rgb_table_bits) - 1u;
+	unsigned candidate[3u];
+	for (unsigned value = 0u; rgb_table_size > value; ++value) {
+		for (unsigned c = 0u; 3u > c; ++c) {
+			// Middle of the component's reduced range
+			rgb[c]
+				= (((value >> ((2u - c) * rgb_table_bits)) & component_mask)
+					<< (8u - rgb_table_bits))
+				| (1u << (7u - rgb_table_bits))
+			;
+		}
+		unsigned const cube
+			= palette_cube_first
+			+ 36u * nearest_cube_level(rgb[0u])
+			+ 6u * nearest_cube_level(rgb[1u])
+			+ nearest_cube_level(rgb[2u])
+		;
+		unsigned const average = (rgb[0u] + rgb[1u] + rgb[2u]) / 3u;
+		unsigned const gray
+			= palette_gray_first
+			+ min_ce(
+				unsigned{palette_gray_count - 1u},
+				(8u < average) ? (average - 3u) / 10u : 0u
+			)
+		;
+		palette_rgb(cube, candidate);
+		unsigned const cube_distance = color_distance(rgb, candidate);
+		palette_rgb(gray, candidate);
+		tables.rgb_to_index[value] = static_cast<std::uint8_t>(
+			color_distance(rgb, candidate) < cube_distance ? gray : cube
+		);
+	}
+	return tables;
+}
+
+static ColorTables const&
+color_tables() noexcept {
+	static ColorTables const s_tables = make_color_tables();
+	return s_tables;
+}
+
+// Reduce the color of an attribute to the nearest color the terminal
+// can display, in canonical form: basic colors (and palette colors
+// reduced to them) as tty::Color values, other palette colors as
+// palette indices, and RGB colors only if they are displayed
+// directly
+static unsigned
+resolve_color(
+	Terminal const& terminal,
+	unsigned const attr
+) noexcept {
+	unsigned const max_colors
+		= (0u != terminal.m_opt_max_colors)
+		? terminal.m_opt_max_colors
+		: terminal.m_cap_max_colors
+	;
+	unsigned const color = attr & tty::Color::mask;
+	unsigned const value = color & tty::Color::mask_value;
+	unsigned const component_mask = (1u << rgb_table_bits) - 1u;
+	auto const& tables = color_tables();
+	unsigned index;
+	switch (color & tty::Color::mask_kind) {
+	case 0u:
+		// Colors that can't be represented fall back to the default,
+		// just as they would after an attribute reset
+		return
+			tty::Color::white < color
+			? unsigned{tty::Color::term_default}
+			: color
+		;
+
+	case tty::Color::kind_index:
+		index = value;
+		break;
+
+	case tty::Color::kind_rgb:
+		if (direct_color_count <= max_colors) {
+			return color;
+		}
+		index = tables.rgb_to_index[
+			((value >> (24u - rgb_table_bits)) << (2u * rgb_table_bits)) |
+			(((value >> (16u - rgb_table_bits)) & component_mask)
+				<< rgb_table_bits) |
+			((value >> (8u - rgb_table_bits)) & component_mask)
+		];
+		break;
+
+	default:
+		return tty::Color::term_default;
+	}
+	if (16u > max_colors) {
+		index = tables.index_to_8[index];
+	} else if (palette_size > max_colors) {
+		index = tables.index_to_16[index];
+	}
+	return
+		8u > index
+		? tty::Color::black + index
+		: tty::Color::kind_index | index
+	;
+}
+
 // rendering
 
-#define BEARD_TERMINAL_WRITE_STRLIT(s_, sl_) \
-	(s_).write((sl_), sizeof(sl_) - 1)
+#define BEARD_TERMINAL_WRITE_STRLIT(out_, sl_) \
+	(out_).append((sl_), sizeof(sl_) - 1)
+
+static unsigned
+decimal_size(
+	unsigned value
+) noexcept {
+	unsigned size = 1u;
+	for (; 10u <= value; value /= 10u) {
+		++size;
+	}
+	return size;
+}
+
+enum : unsigned {
+	decimal_max_size = 10u,
+};
+
+// Encode value in decimal to the end of buffer (which must have at
+// least decimal_max_size units); returns the first unit
+static char*
+encode_decimal(
+	char* const buffer_end,
+	unsigned value
+) noexcept {
+	char* it = buffer_end;
+	while (100u <= value) {
+		unsigned const pair = (value % 100u) << 1u;
+		value /= 100u;
+		*--it = s_decimal_pairs[pair + 1u];
+		*--it = s_decimal_pairs[pair];
+	}
+	if (10u <= value) {
+		*--it = s_decimal_pairs[(value << 1u) + 1u];
+		*--it = s_decimal_pairs[value << 1u];
+	} else {
+		*--it = static_cast<char>('0' + value);
+	}
+	return it;
+}
+
+static void
+write_decimal(
+	Terminal::OutBuffer& out,
+	unsigned const value
+) {
+	char buffer[decimal_max_size];
+	char const* const end = buffer + decimal_max_size;
+	char const* const first = encode_decimal(buffer + decimal_max_size, value);
+	out.append(first, static_cast<std::size_t>(end - first));
+}
+
+// Parametrized caps
+
+struct ParmOutput final {
+	char const* data;
+	unsigned size;
+};
+
+static void
+clear_parm_cache(
+	Terminal& terminal
+) noexcept {
+	for (auto& entry : terminal.m_parm_cache) {
+		entry.cap = static_cast<std::uint8_t>(Terminal::ParmCap::COUNT);
+	}
+}
+
+inline static bool
+has_parm(
+	Terminal const& terminal,
+	Terminal::ParmCap const cap
+) noexcept {
+	return !terminal.m_parm_programs[enum_cast(cap)].empty();
+}
+
+// Get the output of a parametrized cap. On a cache miss the cap is
+// evaluated into the unused capacity of the output buffer and cached
+// if it fits; the output is valid until the output buffer is next
+// appended to.
+static ParmOutput
+eval_parm(
+	Terminal& terminal,
+	Terminal::ParmCap const cap,
+	signed const p1,
+	signed const p2 = 0
+) {
+	std::uint64_t const key
+		= ((std::uint64_t{enum_cast(cap)} << 32u) | unsigned_cast(p1))
+		* s_hash_prime1
+		^ std::uint64_t{unsigned_cast(p2)} * s_hash_prime2
+	;
+	auto& entry = terminal.m_parm_cache[
+		(key >> 32u) & (Terminal::parm_cache_size - 1u)
+	];
+	if (
+		enum_cast(cap) == entry.cap &&
+		p1 == entry.p1 &&
+		p2 == entry.p2
+	) {
+		return {entry.data, entry.size};
+	}
+
+	auto const& program = terminal.m_parm_programs[enum_cast(cap)];
+	auto& out = terminal.m_out;
+	out.reserve(out.size + program.max_size());
+	char* const data = out.data() + out.size;
+	tty::ParmProgram::value_type const params[]{p1, p2};
+	unsigned const size = static_cast<unsigned>(
+		program.evaluate(data, params, 2u)
+	);
+	if (Terminal::parm_cache_data_size < size) {
+		return {data, size};
+	}
+	entry.p1 = p1;
+	entry.p2 = p2;
+	entry.cap = static_cast<std::uint8_t>(cap);
+	entry.size = static_cast<std::uint8_t>(size);
+	std::memcpy(entry.data, data, size);
+	return {entry.data, size};
+}
+
+static void
+write_parm(
+	Terminal& terminal,
+	Terminal::ParmCap const cap,
+	signed const p1,
+	signed const p2 = 0
+) {
+	auto& out = terminal.m_out;
+	auto const output = eval_parm(terminal, cap, p1, p2);
+	if (out.data() + out.size == output.data) {
+		// Evaluated in place
+		out.size += output.size;
+	} else {
+		out.append(output.data, output.size);
+	}
+}
+
+// Whether repos_out() evaluates cursor_address
+inline static bool
+repos_parm(
+	Terminal const& terminal
+) noexcept {
+	return
+		!terminal.m_states.test(Terminal::State::cap_ansi_cursor_address) &&
+		has_parm(terminal, Terminal::ParmCap::cursor_address)
+	;
+}
+
+// Number of units that repos_out() writes
+static unsigned
+repos_size(
+	Terminal& terminal,
+	geom_value_type const x,
+	geom_value_type const y
+) {
+	if (repos_parm(terminal)) {
+		return eval_parm(terminal, Terminal::ParmCap::cursor_address, y, x).size;
+	}
+	return
+		4u
+		+ decimal_size(unsigned_cast(x + 1))
+		+ decimal_size(unsigned_cast(y + 1))
+	;
+}
 
 static void
 repos_out(
-	std::ostream& stream,
+	Terminal& terminal,
 	geom_value_type const x,
 	geom_value_type const y
 ) {
-	BEARD_TERMINAL_WRITE_STRLIT(stream, "\033[");
-	String str{std::to_string(y + 1u)};
-	stream.write(str.data(), str.size());
-	BEARD_TERMINAL_WRITE_STRLIT(stream, ";");
+	auto& out = terminal.m_out;
+	if (repos_parm(terminal)) {
+		write_parm(terminal, Terminal::ParmCap::cursor_address, y, x);
+	} else {
+		// CUP, or assumed to be
+		BEARD_TERMINAL_WRITE_STRLIT(out, "\033[");
+		write_decimal(out, unsigned_cast(y + 1));
+		BEARD_TERMINAL_WRITE_STRLIT(out, ";");
+		write_decimal(out, unsigned_cast(x + 1));
+		BEARD_TERMINAL_WRITE_STRLIT(out, "H");
+	}
 
-	str.assign(std::to_string(x + 1u));
-	stream.write(str.data(), str.size());
-	BEARD_TERMINAL_WRITE_STRLIT(stream, "H");
+	terminal.m_out_pos.x = x;
+	terminal.m_out_pos.y = y;
 }
 
 static void
-write_colors(
-	std::ostream& stream,
-	unsigned const color_fg,
-	unsigned const color_bg
-) {
-	enum : unsigned {
-		color16_max = 0x09
-	};
+invalidate_out_pos(
+	Terminal& terminal
+) noexcept {
+	terminal.m_out_pos.x = -1;
+	terminal.m_out_pos.y = -1;
+}
 
-	unsigned const def
-		= (tty::Color::term_default != color_fg)
-		| (tty::Color::term_default != color_bg) << 1u
-	;
-	if (!def) {
-		return;
-	} else if ((color16_max >= color_fg) && (color16_max >= color_bg)) {
-		char cc = ('0' - 1);
-		switch (def) {
-		case 0x01: // FG
-			BEARD_TERMINAL_WRITE_STRLIT(stream, "\033[3");
-			cc += color_fg;
-			stream.write(&cc, 1);
-			BEARD_TERMINAL_WRITE_STRLIT(stream, "m");
-			break;
+// Advance the output cursor past a cell of columns width written at
+// the output position
+static void
+advance_out_pos(
+	Terminal& terminal,
+	geom_value_type const columns = 1
+) noexcept {
+	terminal.m_out_pos.x += columns;
+	if (terminal.m_tty_size.width == terminal.m_out_pos.x) {
+		// Either waiting to wrap or wrapped to the next line
+		terminal.m_out_pos.x = -1;
+		if (!terminal.m_states.test(Terminal::State::cap_deferred_wrap)) {
+			terminal.m_out_pos.y = -1;
+		}
+	}
+}
 
-		case 0x02: // BG
-			BEARD_TERMINAL_WRITE_STRLIT(stream, "\033[4");
-			cc += color_bg;
-			stream.write(&cc, 1);
-			BEARD_TERMINAL_WRITE_STRLIT(stream, "m");
-			break;
+enum class MoveKind : unsigned {
+	absolute,
+	rewrite,
+	forward,
+	parm_forward,
+};
 
-		case 0x03: // FG && BG
-			BEARD_TERMINAL_WRITE_STRLIT(stream, "\033[3");
-			cc += color_fg;
-			stream.write(&cc, 1);
-			BEARD_TERMINAL_WRITE_STRLIT(stream, ";4");
-			cc = ('0' - 1) + color_bg;
-			stream.write(&cc, 1);
-			BEARD_TERMINAL_WRITE_STRLIT(stream, "m");
-			break;
+// Cost of moving forward from column x0 to x1 (x0 < x1) on row,
+// either by rewriting the cells in between, by cursor_right, or by
+// parm_right_cursor
+static unsigned
+forward_cost(
+	Terminal& terminal,
+	tty::Cell const* const row,
+	geom_value_type const x0,
+	geom_value_type const x1,
+	unsigned const limit,
+	MoveKind& kind
+) {
+	auto const& right
+		= terminal.m_cap_cache[enum_cast(Terminal::CapCache::cursor_right)];
+	unsigned const count = unsigned_cast(x1 - x0);
+	unsigned cost = limit;
+	kind = MoveKind::absolute;
+	if (!right.empty() && limit > count * right.size()) {
+		cost = count * right.size();
+		kind = MoveKind::forward;
+	}
+	if (has_parm(terminal, Terminal::ParmCap::parm_right_cursor)) {
+		unsigned const parm_cost
+			= terminal.m_states.test(Terminal::State::cap_ansi_parm_right_cursor)
+			? 3u + decimal_size(count)
+			: eval_parm(
+				terminal,
+				Terminal::ParmCap::parm_right_cursor,
+				signed_cast(count)
+			).size
+		;
+		if (cost > parm_cost) {
+			cost = parm_cost;
+			kind = MoveKind::parm_forward;
+		}
+	}
+	if (cost >= limit) {
+		cost = limit;
+		kind = MoveKind::absolute;
+	}
+
+	// Unchanged cells can be rewritten as-is if they don't need an
+	// attribute change; continuation cells are covered by their wide
+	// cell and the range never splits one
+	unsigned rewrite = 0u;
+	for (auto x = x0; x1 > x && cost > rewrite; ++x) {
+		auto const& cell = row[x];
+		if (
+			cell.attr_fg != terminal.m_attr_fg_last ||
+			cell.attr_bg != terminal.m_attr_bg_last
+		) {
+			return cost;
+		} else if (!tty::is_continuation(cell)) {
+			rewrite += cell_units(terminal, cell).size;
+		}
+	}
+	if (cost > rewrite) {
+		cost = rewrite;
+		kind = MoveKind::rewrite;
+	}
+	return cost;
+}
+
+static void
+write_forward(
+	Terminal& terminal,
+	tty::Cell const* const row,
+	geom_value_type const x0,
+	geom_value_type const x1,
+	MoveKind const kind
+) {
+	auto& out = terminal.m_out;
+	if (MoveKind::rewrite == kind) {
+		for (auto x = x0; x1 > x; ++x) {
+			if (!tty::is_continuation(row[x])) {
+				auto const units = cell_units(terminal, row[x]);
+				out.append(units.data, units.size);
+			}
 		}
+	} else if (
+		MoveKind::parm_forward == kind &&
+		terminal.m_states.test(Terminal::State::cap_ansi_parm_right_cursor)
+	) {
+		BEARD_TERMINAL_WRITE_STRLIT(out, "\033[");
+		write_decimal(out, unsigned_cast(x1 - x0));
+		BEARD_TERMINAL_WRITE_STRLIT(out, "C");
+	} else if (MoveKind::parm_forward == kind) {
+		write_parm(terminal, Terminal::ParmCap::parm_right_cursor, x1 - x0);
 	} else {
-		// TODO: xterm-style color extension support
+		for (auto x = x0; x1 > x; ++x) {
+			terminal.put_cap_cache(Terminal::CapCache::cursor_right);
+		}
 	}
 }
 
+// Move the output cursor to (x, y) on the back buffer row using the
+// cheapest of: absolute positioning; moving forward on the current
+// line; or carriage return, line feeds and moving forward
 static void
-write_attrs(
+move_out(
 	Terminal& terminal,
-	unsigned const attr_fg,
-	unsigned const attr_bg,
-	bool const force = false
+	geom_value_type const x,
+	geom_value_type const y,
+	tty::Cell const* const row
+) {
+	auto const& pos = terminal.m_out_pos;
+	if (x == pos.x && y == pos.y) {
+		return;
+	}
+
+	auto const& cr
+		= terminal.m_cap_cache[enum_cast(Terminal::CapCache::carriage_return)];
+	auto const& down
+		= terminal.m_cap_cache[enum_cast(Terminal::CapCache::cursor_down)];
+
+	// Absolute position
+	unsigned best = repos_size(terminal, x, y);
+	bool use_cr = false;
+	geom_value_type from_x = 0;
+	MoveKind kind = MoveKind::absolute;
+	if (-1 != pos.y && y >= pos.y && (y == pos.y || !down.empty())) {
+		unsigned const vertical = unsigned_cast(y - pos.y) * down.size();
+		unsigned cost = 0u;
+		MoveKind fkind{};
+
+		// Straight down and/or forward
+		if (-1 != pos.x && x >= pos.x && best > vertical) {
+			cost = vertical;
+			fkind = MoveKind::forward;
+			if (x != pos.x) {
+				cost += forward_cost(
+					terminal, row, pos.x, x, best - vertical, fkind
+				);
+			}
+			if (MoveKind::absolute != fkind && best > cost) {
+				best = cost;
+				kind = fkind;
+				from_x = pos.x;
+			}
+		}
+
+		// Carriage return, down and forward
+		if (!cr.empty() && best > cr.size() + vertical) {
+			cost = cr.size() + vertical;
+			fkind = MoveKind::forward;
+			if (0 != x) {
+				cost += forward_cost(
+					terminal, row, 0, x, best - cost, fkind
+				);
+			}
+			if (MoveKind::absolute != fkind && best > cost) {
+				best = cost;
+				kind = fkind;
+				from_x = 0;
+				use_cr = true;
+			}
+		}
+	}
+
+	if (MoveKind::absolute == kind) {
+		repos_out(terminal, x, y);
+		return;
+	}
+	if (use_cr) {
+		terminal.put_cap_cache(Terminal::CapCache::carriage_return);
+	}
+	for (auto line = pos.y; y > line; ++line) {
+		terminal.put_cap_cache(Terminal::CapCache::cursor_down);
+	}
+	if (x != from_x) {
+		write_forward(terminal, row, from_x, x, kind);
+	}
+	terminal.m_out_pos.x = x;
+	terminal.m_out_pos.y = y;
+}
+
+// SGR parameter composition
+
+struct sgr_builder final {
+	char data[sgr_max_size];
+	unsigned size{0u};
+
+	void
+	param(
+		char const* p
+	) noexcept {
+		if (0u != size) {
+			data[size++] = ';';
+		}
+		while ('\0' != *p) {
+			data[size++] = *p++;
+		}
+	}
+
+	void
+	number(
+		unsigned const value
+	) noexcept {
+		if (0u != size) {
+			data[size++] = ';';
+		}
+		char buffer[decimal_max_size];
+		char const* const end = buffer + decimal_max_size;
+		char const* it = encode_decimal(buffer + decimal_max_size, value);
+		for (; end != it; ++it) {
+			data[size++] = *it;
+		}
+	}
+
+	// base is 30 for foreground and 40 for background; color must be
+	// resolved
+	void
+	color(
+		unsigned const base,
+		unsigned const color
+	) noexcept {
+		unsigned const value = color & tty::Color::mask_value;
+		switch (color & tty::Color::mask_kind) {
+		case tty::Color::kind_index:
+			if (16u > value) {
+				// Bright colors (aixterm)
+				number(base + 60u + value - 8u);
+			} else {
+				number(base + 8u);
+				number(5u);
+				number(value);
+			}
+			break;
+
+		case tty::Color::kind_rgb:
+			number(base + 8u);
+			number(2u);
+			number(value >> 16u);
+			number((value >> 8u) & 0xFFu);
+			number(value & 0xFFu);
+			break;
+
+		default:
+			number(
+				tty::Color::term_default == color
+				? base + 9u
+				: base - 1u + color
+			);
+			break;
+		}
+	}
+};
+
+inline static unsigned
+sgr_flags(
+	unsigned const attr_fg,
+	unsigned const attr_bg
+) noexcept {
+	return
+		((attr_fg & tty::Attr::bold) ? sgr_bold : 0u) |
+		((attr_fg & tty::Attr::underline) ? sgr_underline : 0u) |
+		((attr_bg & tty::Attr::blink) ? sgr_blink : 0u) |
+		(((attr_fg | attr_bg) & tty::Attr::inverted) ? sgr_reverse : 0u)
+	;
+}
+
+// Parameter of set_a_foreground and set_a_background for a resolved
+// basic or palette color
+inline static signed
+color_parm(
+	unsigned const color
+) noexcept {
+	return signed_cast(
+		tty::Color::kind_index == (color & tty::Color::mask_kind)
+		? color & tty::Color::mask_value
+		: color - tty::Color::black
+	);
+}
+
+// Write resolved colors that aren't the default as a single SGR
+// sequence, or with the color caps if they aren't plain SGR. RGB
+// colors and colors without a cap are always written as SGR, as are
+// palette colors if the color caps take RGB values.
+static void
+write_colors(
+	Terminal& terminal,
+	unsigned const color_fg,
+	unsigned const color_bg
+) {
+	auto& out = terminal.m_out;
+	bool const compose
+		= terminal.m_states.test(Terminal::State::cap_ansi_color);
+	unsigned const sgr_kinds
+		= terminal.m_states.test(Terminal::State::cap_ext_rgb)
+		? tty::Color::mask_kind
+		: unsigned{tty::Color::kind_rgb}
+	;
+	sgr_builder sgr{};
+	auto const add = [&terminal, &sgr, compose, sgr_kinds](
+		Terminal::ParmCap const cap,
+		unsigned const base,
+		unsigned const color
+	) {
+		if (tty::Color::term_default == color) {
+			return;
+		} else if (
+			!compose &&
+			has_parm(terminal, cap) &&
+			0u == (color & sgr_kinds)
+		) {
+			write_parm(terminal, cap, color_parm(color));
+		} else {
+			sgr.color(base, color);
+		}
+	};
+	add(Terminal::ParmCap::set_a_foreground, 30u, color_fg);
+	add(Terminal::ParmCap::set_a_background, 40u, color_bg);
+	if (0u != sgr.size) {
+		BEARD_TERMINAL_WRITE_STRLIT(out, "\033[");
+		out.append(sgr.data, sgr.size);
+		BEARD_TERMINAL_WRITE_STRLIT(out, "m");
+	}
+}
+
+// Whether the color caps are absent or write the same plain SGR
+// colors as sgr_builder for the palette colors the terminal has; if
+// the caps take RGB values, only the basic eight are palette colors
+static bool
+color_caps_are_sgr(
+	Terminal& terminal
+) {
+	bool const rgb = terminal.m_states.test(Terminal::State::cap_ext_rgb);
+	unsigned const basic_count
+		= min_ce(terminal.m_cap_max_colors, rgb ? 8u : 16u);
+	unsigned const extra_count
+		= (!rgb && palette_size <= terminal.m_cap_max_colors) ? 2u : 0u;
+	unsigned const extra[]{16u, palette_size - 1u};
+	auto const cap_is_sgr = [&](
+		Terminal::ParmCap const cap,
+		unsigned const base
+	) -> bool {
+		if (!has_parm(terminal, cap)) {
+			return true;
+		}
+		for (unsigned idx = 0u; basic_count + extra_count > idx; ++idx) {
+			unsigned const index
+				= basic_count > idx ? idx : extra[idx - basic_count];
+			unsigned const color
+				= 8u > index
+				? tty::Color::black + index
+				: tty::Color::kind_index | index
+			;
+			sgr_builder sgr{};
+			sgr.color(base, color);
+			auto const output = eval_parm(terminal, cap, color_parm(color));
+			if (
+				output.size != sgr.size + 3u ||
+				0 != std::memcmp(output.data, "\033[", 2u) ||
+				0 != std::memcmp(output.data + 2u, sgr.data, sgr.size) ||
+				'm' != output.data[output.size - 1u]
+			) {
+				return false;
+			}
+		}
+		return true;
+	};
+	return
+		cap_is_sgr(Terminal::ParmCap::set_a_foreground, 30u) &&
+		cap_is_sgr(Terminal::ParmCap::set_a_background, 40u)
+	;
+}
+
+// Write the smallest single SGR sequence that takes the terminal
+// from one attribute pair to another: either the delta (turning off
+// removed attributes individually) or a reset followed by the full
+// target state.
+static void
+write_sgr_delta(
+	Terminal& terminal,
+	unsigned const from_fg,
+	unsigned const from_bg,
+	unsigned const to_fg,
+	unsigned const to_bg
+) {
+	auto& out = terminal.m_out;
+	unsigned const
+		from_flags = sgr_flags(from_fg, from_bg),
+		to_flags = sgr_flags(to_fg, to_bg),
+		from_color_fg = resolve_color(terminal, from_fg),
+		from_color_bg = resolve_color(terminal, from_bg),
+		to_color_fg = resolve_color(terminal, to_fg),
+		to_color_bg = resolve_color(terminal, to_bg)
+	;
+
+	sgr_builder delta{};
+	for (unsigned idx = 0u; sgr_flag_count > idx; ++idx) {
+		unsigned const flag = bit(idx);
+		if ((from_flags & flag) && !(to_flags & flag)) {
+			delta.param(s_sgr_param_off[idx]);
+		} else if (!(from_flags & flag) && (to_flags & flag)) {
+			delta.param(s_sgr_param_on[idx]);
+		}
+	}
+	if (from_color_fg != to_color_fg) {
+		delta.color(30u, to_color_fg);
+	}
+	if (from_color_bg != to_color_bg) {
+		delta.color(40u, to_color_bg);
+	}
+	if (0u == delta.size) {
+		return;
+	}
+
+	sgr_builder const* sgr = &delta;
+	sgr_builder reset{};
+	if (from_flags & ~to_flags) {
+		reset.param("0");
+		for (unsigned idx = 0u; sgr_flag_count > idx; ++idx) {
+			if (to_flags & bit(idx)) {
+				reset.param(s_sgr_param_on[idx]);
+			}
+		}
+		if (tty::Color::term_default != to_color_fg) {
+			reset.color(30u, to_color_fg);
+		}
+		if (tty::Color::term_default != to_color_bg) {
+			reset.color(40u, to_color_bg);
+		}
+		if (reset.size < delta.size) {
+			sgr = &reset;
+		}
+	}
+	BEARD_TERMINAL_WRITE_STRLIT(out, "\033[");
+	out.append(sgr->data, sgr->size);
+	BEARD_TERMINAL_WRITE_STRLIT(out, "m");
+}
+
+static void
+clear_sgr_cache(
+	Terminal& terminal
+) noexcept {
+	for (auto& entry : terminal.m_sgr_cache) {
+		entry.to_fg = ~0u;
+	}
+}
+
+static Terminal::SGRCacheEntry&
+sgr_cache_entry(
+	Terminal& terminal,
+	unsigned const from_fg,
+	unsigned const from_bg,
+	unsigned const to_fg,
+	unsigned const to_bg
+) noexcept {
+	std::uint64_t const key
+		= ((std::uint64_t{from_fg} << 32u) | from_bg) * s_hash_prime1
+		^ ((std::uint64_t{to_fg} << 32u) | to_bg) * s_hash_prime2
+	;
+	return terminal.m_sgr_cache[
+		(key >> 32u) & (Terminal::sgr_cache_size - 1u)
+	];
+}
+
+static void
+write_attrs(
+	Terminal& terminal,
+	unsigned const attr_fg,
+	unsigned const attr_bg,
+	bool const force = false
+) {
+	if (
+		!force &&
+		attr_fg == terminal.m_attr_fg_last &&
+		attr_bg == terminal.m_attr_bg_last
+	) {
+		return;
+	}
+
+	// Sequences are deltas from the previous attributes only with SGR
+	// attribute and color caps; a forced write is never cached
+	bool const delta
+		= terminal.m_states.test(Terminal::State::cap_ansi_sgr)
+		&& terminal.m_states.test(Terminal::State::cap_ansi_color)
+	;
+	unsigned const
+		from_fg = delta ? terminal.m_attr_fg_last : 0u,
+		from_bg = delta ? terminal.m_attr_bg_last : 0u
+	;
+	auto& out = terminal.m_out;
+	auto& entry = sgr_cache_entry(terminal, from_fg, from_bg, attr_fg, attr_bg);
+	if (
+		!force &&
+		attr_fg == entry.to_fg &&
+		attr_bg == entry.to_bg &&
+		from_fg == entry.from_fg &&
+		from_bg == entry.from_bg
+	) {
+		out.append(entry.data, entry.size);
+		terminal.m_attr_fg_last = attr_fg;
+		terminal.m_attr_bg_last = attr_bg;
+		return;
+	}
+
+	std::size_t const begin = out.size;
+	if (!force && delta) {
+		write_sgr_delta(
+			terminal,
+			terminal.m_attr_fg_last,
+			terminal.m_attr_bg_last,
+			attr_fg,
+			attr_bg
+		);
+	} else {
+		terminal.put_cap_cache(Terminal::CapCache::exit_attribute_mode);
+		write_colors(
+			terminal,
+			resolve_color(terminal, attr_fg),
+			resolve_color(terminal, attr_bg)
+		);
+		if (attr_fg & tty::Attr::bold) {
+			terminal.put_cap_cache(Terminal::CapCache::enter_bold_mode);
+		}
+		if (attr_fg & tty::Attr::underline) {
+			terminal.put_cap_cache(Terminal::CapCache::enter_underline_mode);
+		}
+		if (attr_bg & tty::Attr::blink) {
+			terminal.put_cap_cache(Terminal::CapCache::enter_blink_mode);
+		}
+		if ((attr_fg & tty::Attr::inverted)
+		 || (attr_bg & tty::Attr::inverted)
+	 	) {
+			terminal.put_cap_cache(Terminal::CapCache::enter_reverse_mode);
+		}
+	}
+	std::size_t const size = out.size - begin;
+	if (!force && Terminal::sgr_cache_data_size >= size) {
+		entry.from_fg = from_fg;
+		entry.from_bg = from_bg;
+		entry.to_fg = attr_fg;
+		entry.to_bg = attr_bg;
+		entry.size = static_cast<std::uint8_t>(size);
+		std::memcpy(entry.data, out.data() + begin, size);
+	}
+	terminal.m_attr_fg_last = attr_fg;
+	terminal.m_attr_bg_last = attr_bg;
+}
+
+enum : unsigned {
+	// Shortest uniform run worth erasing or repeating
+	uniform_run_min = 4u,
+};
+
+// Whether erasing shows the same as writing cell with the current
+// attributes
+static bool
+erases_as(
+	Terminal const& terminal,
+	tty::Cell const& cell
+) noexcept {
+	return
+		' ' == cell.u8block.units[0u] &&
+		1u == cell.u8block.size() &&
+		!(cell.attr_fg & (tty::Attr::underline | tty::Attr::inverted)) &&
+		!(cell.attr_bg & tty::Attr::inverted) && (
+			tty::Color::term_default == (cell.attr_bg & tty::Color::mask) ||
+			terminal.m_states.test(Terminal::State::cap_back_color_erase)
+		)
+	;
+}
+
+// Write the back buffer cells [x0, x1) of row y, which differ from
+// the front buffer. Uniform runs are erased (EL/ECH) or repeated
+// (REP) where the caps allow it and it is shorter. Returns the end
+// of the cells that now match on screen: x1, or the width of the
+// terminal if the rest of the row was erased.
+static geom_value_type
+write_run(
+	Terminal& terminal,
+	tty::Cell const* const row,
+	geom_value_type const y,
+	geom_value_type const x0,
+	geom_value_type const x1
+) {
+	using State = Terminal::State;
+	auto& out = terminal.m_out;
+	auto const& states = terminal.m_states;
+	geom_value_type const width = terminal.m_tty_size.width;
+	geom_value_type x = x0;
+	move_out(terminal, x, y, row);
+	while (x1 > x) {
+		auto const& cell = row[x];
+		write_attrs(terminal, cell.attr_fg, cell.attr_bg);
+
+		geom_value_type run = 1;
+		if (
+			x1 - x >= static_cast<geom_value_type>(uniform_run_min) &&
+			cell == row[x + uniform_run_min - 1u]
+		) {
+			for (; x1 > x + run && cell == row[x + run]; ++run) {}
+		}
+		if (uniform_run_min <= unsigned_cast(run)) {
+			auto const count = unsigned_cast(run);
+			bool const erasable = erases_as(terminal, cell);
+			if (
+				erasable &&
+				x1 == x + run &&
+				states.test(State::cap_ansi_clr_eol)
+			) {
+				// The cursor does not move
+				geom_value_type tail = run;
+				for (; width > x + tail && cell == row[x + tail]; ++tail) {}
+				if (width == x + tail) {
+					BEARD_TERMINAL_WRITE_STRLIT(out, "\033[K");
+					return width;
+				}
+			}
+			// The cursor does not move, so moving past the erased
+			// cells costs about as much again
+			unsigned const erase_cost = 3u + decimal_size(count);
+			if (
+				erasable &&
+				states.test(State::cap_ansi_erase_chars) &&
+				count > erase_cost * ((x1 == x + run) ? 1u : 2u)
+			) {
+				BEARD_TERMINAL_WRITE_STRLIT(out, "\033[");
+				write_decimal(out, count);
+				BEARD_TERMINAL_WRITE_STRLIT(out, "X");
+				// The output position stays before the erased cells
+				// unless more cells follow
+				x += run;
+				if (x1 > x) {
+					move_out(terminal, x, y, row);
+				}
+				continue;
+			}
+			auto const size = cell.u8block.size();
+			if (
+				states.test(State::cap_ansi_repeat_char) &&
+				// REP repeats the last code point, not the cluster
+				!tty::is_cluster_ref(cell) &&
+				size == txt::EncUtils::required_first_whole(cell.u8block.units[0u]) &&
+				(count - 1u) * size > 3u + decimal_size(count - 1u)
+			) {
+				out.append(cell.u8block.units, size);
+				BEARD_TERMINAL_WRITE_STRLIT(out, "\033[");
+				write_decimal(out, count - 1u);
+				BEARD_TERMINAL_WRITE_STRLIT(out, "b");
+				advance_out_pos(terminal, run);
+				x += run;
+				continue;
+			}
+		} else if (x1 > x + 1 && tty::is_continuation(row[x + 1])) {
+			// Wide cell; its continuation cell is covered
+			auto const units = cell_units(terminal, cell);
+			out.append(units.data, units.size);
+			advance_out_pos(terminal, 2);
+			x += 2;
+			continue;
+		}
+		// The run is written as-is; its cells have the same
+		// attributes
+		auto const units = cell_units(terminal, cell);
+		for (geom_value_type const end = x + run; end > x; ++x) {
+			out.append(units.data, units.size);
+			advance_out_pos(terminal);
+		}
+	}
+	return x1;
+}
+
+// Set the scroll region to the rows [top, bottom)
+static void
+write_scroll_region(
+	Terminal& terminal,
+	geom_value_type const top,
+	geom_value_type const bottom
+) {
+	auto& out = terminal.m_out;
+	if (terminal.m_states.test(Terminal::State::cap_ansi_scroll_region)) {
+		BEARD_TERMINAL_WRITE_STRLIT(out, "\033[");
+		write_decimal(out, unsigned_cast(top + 1));
+		BEARD_TERMINAL_WRITE_STRLIT(out, ";");
+		write_decimal(out, unsigned_cast(bottom));
+		BEARD_TERMINAL_WRITE_STRLIT(out, "r");
+	} else {
+		write_parm(
+			terminal, Terminal::ParmCap::change_scroll_region,
+			top, bottom - 1
+		);
+	}
+}
+
+static void
+put_cap_cache_n(
+	Terminal& terminal,
+	Terminal::CapCache const cap,
+	geom_value_type count
+) {
+	for (; 0 < count; --count) {
+		terminal.put_cap_cache(cap);
+	}
+}
+
+enum class ScrollMethod : unsigned {
+	none,
+	index,
+	edit_lines,
+};
+
+// How the full-width rows [top, bottom) of the terminal screen can be
+// scrolled up by lines (down if negative).
+// With a scroll region and scroll_forward/scroll_reverse, rows are
+// indexed off the bottom or top margin. Without one, rows are
+// deleted and inserted to the same effect, which only disturbs the
+// rows below bottom in between. Both need cursor_address to reach
+// the margins.
+static ScrollMethod
+scroll_method(
+	Terminal const& terminal,
+	geom_value_type const top,
+	geom_value_type const bottom,
+	geom_value_type const lines
+) noexcept {
+	using CapCache = Terminal::CapCache;
+	auto const& cache = terminal.m_cap_cache;
+	auto const has_cap = [&cache](CapCache const cap) -> bool {
+		return !cache[enum_cast(cap)].empty();
+	};
+	if (!has_parm(terminal, Terminal::ParmCap::cursor_address)) {
+		return ScrollMethod::none;
+	}
+	bool const to_bottom = terminal.m_tty_size.height == bottom;
+	bool const whole_screen = 0 == top && to_bottom;
+	if (
+		(
+			whole_screen ||
+			has_parm(terminal, Terminal::ParmCap::change_scroll_region)
+		) && has_cap(
+			(0 < lines) ? CapCache::scroll_forward : CapCache::scroll_reverse
+		)
+	) {
+		return ScrollMethod::index;
+	} else if (
+		(to_bottom || has_cap(CapCache::insert_line)) &&
+		(to_bottom || has_cap(CapCache::delete_line)) &&
+		has_cap((0 < lines) ? CapCache::delete_line : CapCache::insert_line)
+	) {
+		return ScrollMethod::edit_lines;
+	}
+	return ScrollMethod::none;
+}
+
+// Whether any rows of the terminal screen can be scrolled. A region
+// that is not the whole screen needs a superset of the caps.
+static bool
+can_scroll_out(
+	Terminal const& terminal
+) noexcept {
+	geom_value_type const height = terminal.m_tty_size.height;
+	return
+		ScrollMethod::none != scroll_method(terminal, 0, height, 1) ||
+		ScrollMethod::none != scroll_method(terminal, 0, height, -1)
+	;
+}
+
+// Scroll the full-width rows [top, bottom) of the terminal screen up
+// by lines (down if negative); returns false if the terminal lacks
+// the caps to do so (see scroll_method()).
+static bool
+scroll_out(
+	Terminal& terminal,
+	geom_value_type const top,
+	geom_value_type const bottom,
+	geom_value_type const lines
+) {
+	using CapCache = Terminal::CapCache;
+	auto const method = scroll_method(terminal, top, bottom, lines);
+	if (ScrollMethod::none == method) {
+		return false;
+	}
+	geom_value_type const count = (0 > lines) ? -lines : lines;
+	bool const to_bottom = terminal.m_tty_size.height == bottom;
+	bool const whole_screen = 0 == top && to_bottom;
+
+	begin_sync(terminal);
+	// Exposed rows take the current background
+	write_attrs(
+		terminal,
+		tty::Color::term_default,
+		tty::Color::term_default
+	);
+	if (ScrollMethod::index == method) {
+		if (!whole_screen) {
+			write_scroll_region(terminal, top, bottom);
+		}
+		if (0 < lines) {
+			repos_out(terminal, 0, bottom - 1);
+			put_cap_cache_n(terminal, CapCache::scroll_forward, count);
+		} else {
+			repos_out(terminal, 0, top);
+			put_cap_cache_n(terminal, CapCache::scroll_reverse, count);
+		}
+		if (!whole_screen) {
+			write_scroll_region(terminal, 0, terminal.m_tty_size.height);
+		}
+	} else if (0 < lines) {
+		repos_out(terminal, 0, top);
+		put_cap_cache_n(terminal, CapCache::delete_line, count);
+		if (!to_bottom) {
+			repos_out(terminal, 0, bottom - count);
+			put_cap_cache_n(terminal, CapCache::insert_line, count);
+		}
+	} else {
+		if (!to_bottom) {
+			repos_out(terminal, 0, bottom - count);
+			put_cap_cache_n(terminal, CapCache::delete_line, count);
+		}
+		repos_out(terminal, 0, top);
+		put_cap_cache_n(terminal, CapCache::insert_line, count);
+	}
+	// Scroll regions, index and line editing all move the cursor
+	invalidate_out_pos(terminal);
+	return true;
+}
+
+// Hash the rows of both buffers and find the block of rows that
+// moved the furthest distance vertically since the last frame. If
+// scrolling the block into place saves enough rows from being
+// redrawn, the screen and the front buffer are scrolled and the
+// affected rows are marked dirty; returns true if so.
+// Rows are matched by hash, so a collision only costs a redraw:
+// present() still compares the cells.
+static bool
+detect_scroll(
+	Terminal& terminal
+) {
+	geom_value_type const
+		width = terminal.m_tty_size.width,
+		height = terminal.m_tty_size.height
+	;
+	auto& hashes = terminal.m_row_hashes;
+	auto& slots = terminal.m_hash_slots;
+	auto const mask = slots.size() - 1u;
+	auto const fit = terminal.m_cell_frontbuffer.data();
+	auto const bit = terminal.m_cell_backbuffer.data();
+
+	// Hash rows and index front rows by hash. Clean rows have the
+	// same hash in both buffers.
+	std::fill(slots.begin(), slots.end(), Terminal::HashSlot{0u, -1});
+	for (geom_value_type y = 0; height > y; ++y) {
+		auto& row = hashes[y];
+		if (!row.front_valid) {
+			row.front = hash_row(fit + y * width, unsigned_cast(width));
+			row.front_valid = true;
+		}
+		row.back
+			= terminal.m_dirty_rows[y].empty()
+			? row.front
+			: hash_row(bit + y * width, unsigned_cast(width))
+		;
+		for (auto index = row.front & mask;; index = (index + 1u) & mask) {
+			auto& slot = slots[index];
+			if (-1 == slot.row) {
+				slot.hash = row.front;
+				slot.row = y;
+				break;
+			} else if (row.front == slot.hash) {
+				slot.row = -2;
+				break;
+			}
+		}
+	}
+
+	// Anchor blocks on changed rows that match a unique front row
+	// and grow them while the rows match with the same shift
+	auto const moved = [&hashes](
+		geom_value_type const y,
+		geom_value_type const shift
+	) -> bool {
+		return hashes[y].back == hashes[y + shift].front;
+	};
+	auto const changed = [&hashes](
+		geom_value_type const y
+	) -> bool {
+		return hashes[y].back != hashes[y].front;
+	};
+	geom_value_type
+		best_gain = 0,
+		best_lo = 0,
+		best_hi = 0,
+		best_shift = 0
+	;
+	for (geom_value_type y = 0; height > y;) {
+		auto const hash = hashes[y].back;
+		geom_value_type match = -1;
+		if (changed(y)) {
+			for (
+				auto index = hash & mask;
+				-1 != slots[index].row;
+				index = (index + 1u) & mask
+			) {
+				if (hash == slots[index].hash) {
+					match = slots[index].row;
+					break;
+				}
+			}
+		}
+		if (0 > match) {
+			++y;
+			continue;
+		}
+
+		geom_value_type const shift = match - y;
+		geom_value_type lo = y, hi = y + 1;
+		for (; 0 < lo && 0 < lo + shift && moved(lo - 1, shift); --lo) {}
+		for (
+			; height > hi && height > hi + shift && moved(hi, shift); ++hi
+		) {}
+
+		// Rows saved from redraw, less clean rows that the scroll
+		// exposes
+		geom_value_type gain = 0;
+		for (geom_value_type r = lo; hi > r; ++r) {
+			gain += changed(r) ? 1 : 0;
+		}
+		geom_value_type const
+			exposed_lo = (0 < shift) ? hi : lo + shift,
+			exposed_hi = (0 < shift) ? hi + shift : lo
+		;
+		for (geom_value_type r = exposed_lo; exposed_hi > r; ++r) {
+			gain -= changed(r) ? 0 : 1;
+		}
+		if (best_gain < gain) {
+			best_gain = gain;
+			best_lo = lo;
+			best_hi = hi;
+			best_shift = shift;
+		}
+		y = hi;
+	}
+	if (static_cast<geom_value_type>(Terminal::scroll_detect_min_rows) > best_gain) {
+		return false;
+	}
+
+	geom_value_type const
+		top = (0 < best_shift) ? best_lo : best_lo + best_shift,
+		bottom = (0 < best_shift) ? best_hi + best_shift : best_hi
+	;
+	if (!scroll_out(terminal, top, bottom, best_shift)) {
+		return false;
+	}
+	shift_rows(
+		terminal.m_cell_frontbuffer, width,
+		Rect{{0, top}, {width, bottom - top}},
+		best_shift
+	);
+	std::fill(
+		terminal.m_dirty_rows.begin() + top,
+		terminal.m_dirty_rows.begin() + bottom,
+		Terminal::DirtySpan{0, width}
+	);
+	return true;
+}
+
+// I/O
+
+#define BEARD_SCOPE_FUNC internal::set_nonblocking
+static void
+set_nonblocking(
+	tty::Terminal& terminal,
+	bool const enable
+) noexcept {
+	if (tty::FD_INVALID == terminal.m_tty_fd) {
+		return;
+	}
+	signed const flags = ::fcntl(terminal.m_tty_fd, F_GETFL);
+	if (
+		-1 == flags ||
+		-1 == ::fcntl(
+			terminal.m_tty_fd, F_SETFL,
+			enable ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK)
+		)
+	) {
+		BEARD_DEBUG_CERR_FQN(
+			errno,
+			"failed to set tty file status flags"
+		);
+	}
+}
+#undef BEARD_SCOPE_FUNC
+
+#define BEARD_SCOPE_FUNC internal::watch_output
+static void
+watch_output(
+	tty::Terminal& terminal,
+	bool const enable
+) noexcept {
+	if (enable == terminal.m_states.test(Terminal::State::output_pending)) {
+		return;
+	}
+	terminal.m_states.set(Terminal::State::output_pending, enable);
+	if (tty::FD_INVALID == terminal.m_epoll_fd) {
+		return;
+	}
+
+	struct ::epoll_event epoll_ev{};
+	epoll_ev.events = EPOLLIN | EPOLLPRI | (enable ? EPOLLOUT : 0u);
+	if (0 != ::epoll_ctl(
+		terminal.m_epoll_fd, EPOLL_CTL_MOD, terminal.m_tty_fd, &epoll_ev
+	)) {
+		BEARD_DEBUG_CERR_FQN(
+			errno,
+			"failed to modify tty epoll events"
+		);
+	}
+}
+#undef BEARD_SCOPE_FUNC
+
+// Whether present() should skip the frame
+static bool
+output_backlogged(
+	tty::Terminal const& terminal
+) noexcept {
+	return
+		terminal.m_states.test(Terminal::State::nonblocking_output) && (
+			terminal.m_out_pending_max < terminal.m_out.size || (
+				terminal.m_states.test(Terminal::State::output_pending) &&
+				!terminal.m_states.test(Terminal::State::queue_frames)
+			)
+		)
+	;
+}
+
+static void
+probe_sync_output(
+	tty::Terminal& terminal
+) {
+	// Trust the terminfo entry
+	if (terminal.m_states.test(Terminal::State::cap_ext_sync)) {
+		terminal.m_states.enable(Terminal::State::cap_sync_output);
+		return;
+	}
+	terminal.m_states.enable(Terminal::State::sync_probe_pending);
+	BEARD_TERMINAL_WRITE_STRLIT(terminal.m_out, s_sync_query);
+	flush(terminal);
+}
+
+// Whether the Sync extended cap begins (1) and ends (2) a
+// synchronized update with mode 2026
+static bool
+ext_sync_is_mode_2026(
+	tty::CapStringValue const& cap_value
+) {
+	tty::ParmProgram program{};
+	if (!program.compile(String{cap_value.data, cap_value.size})) {
+		return false;
+	}
+	char buffer[32u];
+	if (sizeof(buffer) < program.max_size()) {
+		return false;
+	}
+	tty::ParmProgram::value_type const params[]{1, 2};
+	std::size_t size = program.evaluate(buffer, params, 1u);
+	if (
+		sizeof("\033[?2026h") - 1u != size ||
+		0 != std::memcmp(buffer, "\033[?2026h", size)
+	) {
+		return false;
+	}
+	size = program.evaluate(buffer, params + 1u, 1u);
+	return
+		sizeof("\033[?2026l") - 1u == size &&
+		0 == std::memcmp(buffer, "\033[?2026l", size)
+	;
+}
+
+// Begin a synchronized update if enabled and supported; it is closed
+// by the next flush
+static void
+begin_sync(
+	tty::Terminal& terminal
 ) {
-	if (force
-	 || attr_fg != terminal.m_attr_fg_last
-	 || attr_bg != terminal.m_attr_bg_last
- 	) {
-		terminal.put_cap_cache(Terminal::CapCache::exit_attribute_mode);
-		write_colors(
-			terminal.m_stream_out,
-			attr_fg & attr_mask_color,
-			attr_bg & attr_mask_color
-		);
-		if (attr_fg & tty::Attr::bold) {
-			terminal.put_cap_cache(Terminal::CapCache::enter_bold_mode);
-		}
-		if (attr_fg & tty::Attr::underline) {
-			terminal.put_cap_cache(Terminal::CapCache::enter_underline_mode);
-		}
-		if (attr_bg & tty::Attr::blink) {
-			terminal.put_cap_cache(Terminal::CapCache::enter_blink_mode);
-		}
-		if ((attr_fg & tty::Attr::inverted)
-		 || (attr_bg & tty::Attr::inverted)
-	 	) {
-			terminal.put_cap_cache(Terminal::CapCache::enter_reverse_mode);
-		}
-		terminal.m_attr_fg_last = attr_fg;
-		terminal.m_attr_bg_last = attr_bg;
+	auto& states = terminal.m_states;
+	if (
+		states.test(Terminal::State::sync_output) &&
+		states.test(Terminal::State::cap_sync_output) &&
+		!states.test(Terminal::State::sync_begun)
+	) {
+		states.enable(Terminal::State::sync_begun);
+		BEARD_TERMINAL_WRITE_STRLIT(terminal.m_out, "\033[?2026h");
 	}
 }
 
-// I/O
+// Consume a synchronized update mode report at the input position;
+// returns whether there is input left to decode
+static bool
+skip_sync_report(
+	tty::Terminal& terminal
+) {
+	auto& streambuf = terminal.m_streambuf_in;
+	char const* const buffer
+		= streambuf.buffer().data()
+		+ streambuf.position()
+	;
+	std::size_t const remaining = streambuf.remaining();
+	std::size_t const prefix_size = sizeof(s_sync_report_prefix) - 1u;
+	std::size_t const compare_size = min_ce(remaining, prefix_size);
+	// Only wait for the rest of the report once the input can't be
+	// an escape key
+	if (
+		3u > remaining ||
+		0 != std::memcmp(buffer, s_sync_report_prefix, compare_size)
+	) {
+		return true;
+	}
+	// The report value is a single digit
+	std::size_t const size = prefix_size + 3u;
+	if (remaining < size) {
+		// Incomplete; wait for the rest
+		return false;
+	} else if (
+		'$' != buffer[prefix_size + 1u] ||
+		'y' != buffer[prefix_size + 2u]
+	) {
+		return true;
+	}
+	// 1 (set) and 2 (reset) mean the mode is recognized and can be
+	// changed
+	char const value = buffer[prefix_size];
+	terminal.m_states.set(
+		Terminal::State::cap_sync_output,
+		'1' == value || '2' == value
+	);
+	terminal.m_states.disable(Terminal::State::sync_probe_pending);
+	streambuf.pubseekoff(
+		static_cast<duct::IO::dynamic_streambuf::off_type>(size),
+		std::ios_base::cur,
+		std::ios_base::in
+	);
+	return 0u < streambuf.remaining();
+}
 
 #define BEARD_SCOPE_FUNC internal::flush
 static void
 flush(
 	tty::Terminal& terminal
 ) {
-	std::size_t const size = terminal.m_streambuf_out.sequence_size();
-	ssize_t written = 0;
-	signed err = 0;
+	auto& out = terminal.m_out;
+	if (terminal.m_states.test(Terminal::State::sync_begun)) {
+		terminal.m_states.disable(Terminal::State::sync_begun);
+		BEARD_TERMINAL_WRITE_STRLIT(out, "\033[?2026l");
+	}
+	std::size_t const size = out.size;
+	if (terminal.is_headless()) {
+		terminal.m_headless_output.append(out.data(), size);
+		out.clear();
+		return;
+	}
+
+	std::size_t written = 0u;
 	unsigned retries = 1;
-	do {
-		written = ::write(
+	while (size > written) {
+		ssize_t const amount = ::write(
 			terminal.m_tty_fd,
-			terminal.m_streambuf_out.buffer().data(),
-			size
+			out.data() + written,
+			size - written
 		);
-		if (-1 == written) {
-			err = errno;
-			BEARD_DEBUG_CERR_FQN(
-				err,
-				"write() failed or was interrupted"
-				" (potentially retrying)"
-			);
-		} else {
+		if (-1 == amount) {
+			signed const err = errno;
+			if (EINTR == err && retries--) {
+				continue;
+			} else if (EAGAIN != err && EWOULDBLOCK != err) {
+				BEARD_DEBUG_CERR_FQN(
+					err,
+					"write() failed"
+				);
+			}
 			break;
 		}
-	} while (retries-- && err == EINTR);
-	if (-1 != written) {
-		if (static_cast<std::size_t>(written) != size) {
-			BEARD_DEBUG_MSG_FQN(
-				"failed to flush all bytes to terminal"
-			);
-			// Slide back the remaining data and seek to end of buffer
-			terminal.m_stream_out.seekp(
-				terminal.m_streambuf_out.discard(
-					static_cast<std::size_t>(written)
-				)
-			);
-		} else {
-			// Reset buffer (position is 0)
-			DUCT_ASSERT(
-				terminal.m_streambuf_out.reset(size),
-				"failed to resize buffer"
-			);
-		}
+		written += static_cast<std::size_t>(amount);
 	}
+
+	// Slide back the remaining data. In non-blocking mode, it is
+	// written by poll() once the tty is writable.
+	out.discard(written);
+	watch_output(
+		terminal,
+		0u != out.size &&
+		terminal.m_states.test(Terminal::State::nonblocking_output)
+	);
 }
 #undef BEARD_SCOPE_FUNC
 
@@ -652,7 +2452,11 @@ Terminal::~Terminal() noexcept {
 
 Terminal::Terminal()
 	: m_tty_priv(new Terminal::terminal_private())
-{}
+{
+	m_out.reserve(outbuf_size);
+	terminal_internal::clear_sgr_cache(*this);
+	terminal_internal::clear_parm_cache(*this);
+}
 
 Terminal::Terminal(
 	tty::TerminalInfo term_info
@@ -660,18 +2464,63 @@ Terminal::Terminal(
 	: m_tty_priv(new Terminal::terminal_private())
 	, m_info(std::move(term_info))
 {
+	m_out.reserve(outbuf_size);
 	update_cache();
 }
 
 Terminal::Terminal(Terminal&&) = default;
 Terminal& Terminal::operator=(Terminal&&) = default;
 
+void
+Terminal::set_opt_nonblocking_output(
+	bool const enable
+) {
+	m_states.set(State::nonblocking_output, enable);
+	if (is_open() && !is_headless()) {
+		terminal_internal::set_nonblocking(*this, enable);
+		if (!enable) {
+			terminal_internal::flush(*this);
+		}
+	}
+}
+
+void
+Terminal::set_opt_max_colors(
+	unsigned const count
+) {
+	m_opt_max_colors = count;
+	terminal_internal::clear_sgr_cache(*this);
+	if (is_open()) {
+		// The current colors may have been reduced differently
+		terminal_internal::write_attrs(
+			*this,
+			tty::Color::term_default,
+			tty::Color::term_default,
+			true
+		);
+	}
+}
+
+void
+Terminal::set_opt_sync_output(
+	bool const enable
+) {
+	m_states.set(State::sync_output, enable);
+	if (
+		enable && is_open() &&
+		!m_states.test(State::cap_sync_output) &&
+		!m_states.test(State::sync_probe_pending)
+	) {
+		terminal_internal::probe_sync_output(*this);
+	}
+}
+
 void
 Terminal::put_cap_cache(
 	CapCache const cap
 ) {
 	auto const& str = m_cap_cache[enum_cast(cap)];
-	m_stream_out.write(str.data(), str.size());
+	m_out.append(str.data(), str.size());
 }
 
 void
@@ -679,7 +2528,11 @@ Terminal::clear_screen(
 	bool const back_dirty
 ) {
 	m_states.set(State::backbuffer_dirty, back_dirty);
-	std::fill(m_dirty_rows.begin(), m_dirty_rows.end(), back_dirty);
+	std::fill(
+		m_dirty_rows.begin(), m_dirty_rows.end(),
+		DirtySpan{0, back_dirty ? m_tty_size.width : 0}
+	);
+	terminal_internal::invalidate_front_hashes(*this, 0, m_tty_size.height);
 
 	terminal_internal::write_attrs(
 		*this,
@@ -688,9 +2541,10 @@ Terminal::clear_screen(
 		true
 	);
 	put_cap_cache(CapCache::clear_screen);
+	terminal_internal::invalidate_out_pos(*this);
 	if (is_caret_visible()) {
 		terminal_internal::repos_out(
-			m_stream_out, m_caret_pos.x, m_caret_pos.y
+			*this, m_caret_pos.x, m_caret_pos.y
 		);
 	}
 	terminal_internal::flush(*this);
@@ -717,11 +2571,16 @@ Terminal::resize(
 		false
 	);
 
-	m_dirty_rows.resize(new_height);
-	clear_screen(m_states.test(State::retain_backbuffer));
-
 	m_tty_size.width  = new_width;
 	m_tty_size.height = new_height;
+
+	m_dirty_rows.resize(new_height);
+	m_row_hashes.resize(new_height);
+	std::size_t slots = 4u;
+	for (; slots < 2u * unsigned_cast(new_height); slots <<= 1u) {}
+	m_hash_slots.resize(slots);
+	terminal_internal::compact_clusters(*this);
+	clear_screen(m_states.test(State::retain_backbuffer));
 	return true;
 }
 
@@ -827,6 +2686,9 @@ Terminal::init(
 			"failed to set termios"
 		);
 	}
+	if (m_states.test(State::nonblocking_output)) {
+		terminal_internal::set_nonblocking(*this, true);
+	}
 
 	put_cap_cache(CapCache::enter_ca_mode);
 	put_cap_cache(CapCache::keypad_xmit);
@@ -836,6 +2698,9 @@ Terminal::init(
 	;
 	update_size();
 	terminal_internal::flush(*this);
+	if (m_states.test(State::sync_output)) {
+		terminal_internal::probe_sync_output(*this);
+	}
 
 	if (use_sigwinch) {
 		terminal_internal::setup_sigwinch_handler(*this);
@@ -868,12 +2733,26 @@ Terminal::deinit() {
 	m_ev_pending.reset();
 
 	terminal_internal::close_fd(m_epoll_fd);
+	m_epoll_fd = tty::FD_INVALID;
 	terminal_internal::release_sigwinch_handler(*this);
 
+	// Write everything that's left
+	if (m_states.test(State::nonblocking_output)) {
+		terminal_internal::set_nonblocking(*this, false);
+	}
+	m_states.disable(State::output_pending);
+	m_states.disable(State::present_deferred);
+	m_states.disable(State::cap_sync_output);
+	m_states.disable(State::sync_probe_pending);
+
 	set_caret_pos(0u, 0u);
 	set_caret_visible(false);
 
 	resize(0u, 0u);
+	// No cell refers to a stored cluster any more
+	m_cluster_map.clear();
+	m_clusters.clear();
+	m_cluster_compact_at = cluster_compact_min;
 	terminal_internal::write_attrs(
 		*this,
 		tty::Color::term_default,
@@ -900,6 +2779,7 @@ Terminal::deinit() {
 
 	m_attr_fg_last = tty::Color::term_default;
 	m_attr_bg_last = tty::Color::term_default;
+	terminal_internal::invalidate_out_pos(*this);
 
 	m_streambuf_in.commit_direct(0u, false);
 }
@@ -919,6 +2799,24 @@ Terminal::poll_input(
 		);
 	}
 
+	if (is_headless()) {
+		// Never blocks; input_timeout is meaningless without a device
+		std::size_t const amount = min_ce(
+			m_headless_input.size(),
+			static_cast<std::size_t>(inbuf_size) - seq_size
+		);
+		if (0u < amount) {
+			std::copy(
+				m_headless_input.cbegin(),
+				m_headless_input.cbegin() + amount,
+				m_streambuf_in.buffer().data() + seq_size
+			);
+			m_headless_input.erase(0u, amount);
+			m_streambuf_in.commit_direct(seq_size + amount, true);
+		}
+		return;
+	}
+
 	struct ::epoll_event ev;
 	signed ready_count = -1, err = 0;
 	unsigned retries = 1;
@@ -944,6 +2842,15 @@ Terminal::poll_input(
 		}
 	} while (retries-- && EINTR == err);
 
+	if (0 < ready_count && (ev.events & EPOLLOUT)) {
+		terminal_internal::flush(*this);
+		if (
+			m_states.test(State::present_deferred) &&
+			!terminal_internal::output_backlogged(*this)
+		) {
+			present();
+		}
+	}
 	if (0 < ready_count && (ev.events & (EPOLLIN | EPOLLPRI))) {
 		err = 0;
 		retries = 1;
@@ -976,6 +2883,12 @@ Terminal::poll_input(
 
 bool
 Terminal::parse_input() {
+	if (
+		m_states.test(State::sync_probe_pending) &&
+		!terminal_internal::skip_sync_report(*this)
+	) {
+		return false;
+	}
 	char const* const buffer
 		= m_streambuf_in.buffer().data()
 		+ m_streambuf_in.position()
@@ -1045,7 +2958,7 @@ Terminal::set_caret_pos(
 		m_caret_pos.y = y;
 		if (is_caret_visible()) {
 			terminal_internal::repos_out(
-				m_stream_out, m_caret_pos.x, m_caret_pos.y
+				*this, m_caret_pos.x, m_caret_pos.y
 			);
 			terminal_internal::flush(*this);
 		}
@@ -1072,9 +2985,6 @@ Terminal::set_caret_visible(
 // TODO: Change colors to term_default if they are larger than the
 // terminal's maximum number of colors
 
-#define BEARD_TERMINAL_CELL_CMP(x_, y_) \
-	std::memcmp(&(x_), &(y_), sizeof(tty::Cell))
-
 void
 Terminal::put_cell(
 	geom_value_type const x,
@@ -1084,13 +2994,39 @@ Terminal::put_cell(
 	if (0 <= x && x < m_tty_size.width
 	 && 0 <= y && y < m_tty_size.height
 	 && '\0' != cell.u8block.units[0u]
+	 && !tty::is_continuation(cell)
 	) {
 		auto const it = m_cell_backbuffer.begin() + (y * m_tty_size.width) + x;
-		if (BEARD_TERMINAL_CELL_CMP(*it, cell)) {
+		geom_value_type columns = 1;
+		if (2u == tty::cell_width(cell)) {
+			if (m_tty_size.width > x + 1) {
+				tty::Cell const continuation = tty::make_continuation_cell(
+					cell.attr_fg, cell.attr_bg
+				);
+				if (*it != cell || *(it + 1) != continuation) {
+					*it = cell;
+					*(it + 1) = continuation;
+					m_states.enable(State::backbuffer_dirty);
+					m_dirty_rows[y].add(x, x + 2);
+				}
+				columns = 2;
+			} else {
+				// No room for the second column
+				tty::Cell blank = cell;
+				blank.u8block.assign(' ');
+				if (*it != blank) {
+					*it = blank;
+					m_states.enable(State::backbuffer_dirty);
+					m_dirty_rows[y].add(x, x + 1);
+				}
+			}
+		} else if (*it != cell) {
 			std::copy(&cell, &cell + 1u, it);
 			m_states.enable(State::backbuffer_dirty);
-			m_dirty_rows[y] = true;
+			m_dirty_rows[y].add(x, x + 1);
 		}
+		terminal_internal::repair_back_split(*this, y, x);
+		terminal_internal::repair_back_split(*this, y, x + columns);
 	}
 }
 
@@ -1099,54 +3035,139 @@ Terminal::put_sequence(
 	geom_value_type x,
 	geom_value_type const y,
 	txt::Sequence const& seq,
-	std::size_t const points,
+	std::size_t const columns,
 	tty::attr_type const attr_fg,
 	tty::attr_type const attr_bg
 ) noexcept {
 	// TODO: Handle \n and clipping
 	if (0 <= x && x < m_tty_size.width && 0 <= y && y < m_tty_size.height) {
 		auto const range = min_ce(
-			points + unsigned_cast(x),
+			columns + unsigned_cast(x),
 			static_cast<std::size_t>(m_tty_size.width)
 		);
-		bool dirtied = false;
+		geom_value_type const x_begin = x;
+		DirtySpan dirtied{0, 0};
 		std::size_t ss_size = 0u;
 		tty::Cell cell{{}, attr_fg, attr_bg};
-		auto it_put = m_cell_backbuffer.begin() + (y * m_tty_size.width) + x;
+		tty::Cell const continuation
+			= tty::make_continuation_cell(attr_fg, attr_bg);
+		auto const row = m_cell_backbuffer.data() + (y * m_tty_size.width);
+		auto const& utf8 = txt::utf8_kernel();
 		auto it_seq = seq.data;
 		auto const seq_end = seq.data + seq.size;
-		for (
-			; seq_end > it_seq && range > unsigned_cast(x);
-			++x,
-			++it_put,
-			it_seq += ss_size
-		) {
-			ss_size = txt::EncUtils::required_first_whole(
-				*it_seq
-			);
-			if (seq_end < seq.data + ss_size) {
-				// incomplete sequence
+		// End of the units known to be valid
+		auto it_valid = it_seq;
+		for (; seq_end > it_seq; it_seq += ss_size) {
+			if (0x80u > static_cast<unsigned char>(*it_seq)) {
+				// ASCII fast path
+				auto const count = utf8.ascii_prefix(
+					it_seq,
+					min_ce(
+						unsigned_cast(seq_end - it_seq),
+						range - unsigned_cast(x)
+					)
+				);
+				if (0u == count) {
+					break;
+				}
+				for (auto const end = it_seq + count; end > it_seq; ++it_seq, ++x) {
+					cell.u8block.assign(*it_seq);
+					// put_cell() inlined
+					if (row[x] != cell) {
+						row[x] = cell;
+						dirtied.add(x, x + 1);
+					}
+				}
+				ss_size = 0u;
+				continue;
+			}
+			if (it_valid <= it_seq) {
+				// Validate about as many units as the remaining columns
+				// can take
+				it_valid = it_seq + utf8.valid_prefix(
+					it_seq,
+					min_ce(
+						unsigned_cast(seq_end - it_seq),
+						4u * (range - unsigned_cast(x) + 1u)
+					)
+				);
+			}
+			char32 cp = duct::CHAR_REPLACEMENT;
+			bool const valid = it_valid > it_seq;
+			if (valid) {
+				ss_size = txt::EncUtils::required_first_whole(*it_seq);
+				txt::EncUtils::decode(
+					it_seq, it_seq + ss_size, cp, duct::CHAR_REPLACEMENT
+				);
+			} else {
+				// The invalid unit and the continuation units after it
+				// are replaced
 				BEARD_DEBUG_MSG_FQN(
-					"encountered incomplete code unit sub-sequence"
+					"encountered invalid code unit sub-sequence"
 					" in Sequence"
 				);
+				ss_size = 1u;
+				for (
+					; txt::EncUtils::max_units > ss_size &&
+					seq_end > it_seq + ss_size &&
+					0x80u == (static_cast<unsigned char>(it_seq[ss_size]) & 0xC0u);
+					++ss_size
+				) {}
+				it_valid = it_seq + ss_size;
+			}
+			unsigned cp_width = txt::code_point_width(cp);
+			if (0u == cp_width) {
+				// Combining code points join the cluster of the
+				// previous cell; they are dropped if it was not put
+				// by this call
+				if (x_begin < x) {
+					auto lead = x - 1;
+					unsigned lead_width = 1u;
+					if (tty::is_continuation(row[lead])) {
+						--lead;
+						lead_width = 2u;
+					}
+					if (terminal_internal::append_cluster(
+						*this, row[lead], lead_width, it_seq, ss_size
+					)) {
+						dirtied.add(lead, lead + 1);
+					}
+				}
+				continue;
+			} else if (range <= unsigned_cast(x)) {
 				break;
 			}
-			cell.u8block.assign(
-				it_seq,
-				ss_size
-			);
+			if (valid) {
+				cell.u8block.assign(it_seq, ss_size);
+			} else {
+				cell.u8block.assign(cp);
+			}
+			if (2u == cp_width && range <= unsigned_cast(x + 1)) {
+				// No room for the second column
+				cell.u8block.assign(' ');
+				cp_width = 1u;
+			}
 
 			// put_cell() inlined
-			if (BEARD_TERMINAL_CELL_CMP(*it_put, cell)) {
-				std::copy(&cell, &cell + 1u, it_put);
-				dirtied = true;
+			if (row[x] != cell) {
+				row[x] = cell;
+				dirtied.add(x, x + 1);
+			}
+			++x;
+			if (2u == cp_width) {
+				if (row[x] != continuation) {
+					row[x] = continuation;
+					dirtied.add(x, x + 1);
+				}
+				++x;
 			}
 		}
-		if (dirtied) {
+		if (!dirtied.empty()) {
 			m_states.enable(State::backbuffer_dirty);
-			m_dirty_rows[y] = true;
+			m_dirty_rows[y].add(dirtied.x0, dirtied.x1);
 		}
+		terminal_internal::repair_back_split(*this, y, x_begin);
+		terminal_internal::repair_back_split(*this, y, x);
 	}
 }
 
@@ -1160,6 +3181,7 @@ Terminal::put_line(
 	// NB: The transpose axis value won't vary
 	if (
 		'\0' == cell.u8block.units[0u] ||
+		tty::is_continuation(cell) ||
 		0 >= length ||
 		!value_in_bounds(
 			vec2_axis_value(position, axis_transpose(direction)),
@@ -1181,21 +3203,38 @@ Terminal::put_line(
 	;
 	if (vec2_axis_value(m_tty_size, direction) > aval) {
 		aval = max_ce(aval, 0);
+		if (2u == tty::cell_width(cell)) {
+			// Wide cells take two columns each
+			geom_value_type const step = Axis::horizontal == direction ? 2 : 1;
+			for (; aval < target; aval += step) {
+				put_cell(position.x, position.y, cell);
+			}
+			return;
+		}
+		geom_value_type const x_begin = position.x;
 		bool dirtied = false;
 		auto it
 			= m_cell_backbuffer.begin()
 			+ (position.y * m_tty_size.width) + position.x
 		;
 		for (; aval < target; ++aval, it += stride) {
-			if (BEARD_TERMINAL_CELL_CMP(*it, cell)) {
+			if (*it != cell) {
 				std::copy(&cell, &cell + 1u, it);
-				m_dirty_rows[position.y] = true;
+				m_dirty_rows[position.y].add(position.x, position.x + 1);
 				dirtied = true;
 			}
+			if (Axis::vertical == direction) {
+				terminal_internal::repair_back_split(*this, position.y, position.x);
+				terminal_internal::repair_back_split(*this, position.y, position.x + 1);
+			}
 		}
 		if (dirtied) {
 			m_states.enable(State::backbuffer_dirty);
 		}
+		if (Axis::horizontal == direction) {
+			terminal_internal::repair_back_split(*this, position.y, x_begin);
+			terminal_internal::repair_back_split(*this, position.y, position.x);
+		}
 	}
 }
 
@@ -1270,101 +3309,132 @@ void
 Terminal::present() {
 	if (!is_open() || !m_states.test(State::backbuffer_dirty)) {
 		return;
+	} else if (terminal_internal::output_backlogged(*this)) {
+		// Output is backlogged; the changes are coalesced into the
+		// next frame
+		m_states.enable(State::present_deferred);
+		return;
 	}
+	m_states.disable(State::present_deferred);
 
-	m_stream_out.clear();
 	//put_cap_cache(CapCache::exit_attribute_mode);
 
+	// Trim dirty spans to their first differing cell; rows that did
+	// not actually change are clean
+	auto const& diff = tty::diff_kernel();
+	auto const count_dirty_cells = [this]() -> std::size_t {
+		std::size_t dirty_cells = 0u;
+		for (auto const& span : m_dirty_rows) {
+			if (!span.empty()) {
+				dirty_cells += unsigned_cast(span.x1 - span.x0);
+			}
+		}
+		return dirty_cells;
+	};
+	{
+		auto fit_row = m_cell_frontbuffer.data();
+		auto bit_row = m_cell_backbuffer.data();
+		for (auto& span : m_dirty_rows) {
+			if (!span.empty()) {
+				span.x0 += static_cast<geom_value_type>(diff.find_differ(
+					fit_row + span.x0, bit_row + span.x0,
+					unsigned_cast(span.x1 - span.x0)
+				));
+				if (span.empty()) {
+					span.reset();
+				}
+			}
+			fit_row += m_tty_size.width;
+			bit_row += m_tty_size.width;
+		}
+	}
+	std::size_t dirty_cells = count_dirty_cells();
+	if (0u < dirty_cells) {
+		terminal_internal::begin_sync(*this);
+	}
+
+	// A scroll can at most save the dirty cells from being redrawn,
+	// so rows are only hashed when that amounts to enough rows.
+	// Hashing only the dirty rows here is cheaper than keeping
+	// hashes up to date in the put functions, which would cost every
+	// frame and every overwrite of a cell.
+	bool const hashed
+		= scroll_detect_min_rows * unsigned_cast(m_tty_size.width) <= dirty_cells
+		&& !m_states.test(State::no_scroll_detection)
+		&& terminal_internal::can_scroll_out(*this)
+	;
+	if (hashed && terminal_internal::detect_scroll(*this)) {
+		dirty_cells = count_dirty_cells();
+	}
+
+	// Reserve for an average of a few units per dirty cell to avoid
+	// growing the buffer mid-frame
+	m_out.reserve(m_out.size + dirty_cells * out_reserve_per_cell);
+
 	// FIXME: Hide caret when flushing?
-	// TODO: No-change optimization: add state flag to signify any
-	// change in the backbuffer
-	// TODO: Gah, this is such a mess; try reducing some of the
-	// loop state
-	// TODO: Debug output/error on !m_stream_out.good()
 	auto it_dirty = m_dirty_rows.begin();
-	cell_vector_type::iterator
-		fit_row,
-		fit_row_n,
-		fit_col
-	;
-	cell_vector_type::const_iterator
-		bit_row,
-		bit_col
-	;
-	geom_value_type row = 0;
-	unsigned
-		cseq_f = 0u,
-		cseq_e = 0u
-	;
+	auto fit_row = m_cell_frontbuffer.data();
+	auto bit_row = m_cell_backbuffer.data();
 	for (
-		fit_row = m_cell_frontbuffer.begin(),
-		fit_row_n = fit_row + m_tty_size.width,
-		bit_row = m_cell_backbuffer.cbegin()
-		; m_tty_size.height != row
-		; fit_row = fit_row_n,
-		// FIXME: Danger danger. stdlib should be OK with this?
-		// (It's not being dereferenced.)
-		fit_row_n += m_tty_size.width,
-		bit_row += m_tty_size.width,
+		geom_value_type row = 0;
+		m_tty_size.height != row;
+		++row,
 		++it_dirty,
-		++row
+		fit_row += m_tty_size.width,
+		bit_row += m_tty_size.width
 	) {
-		if (!*it_dirty) {
+		if (it_dirty->empty()) {
 			continue;
 		}
-		for (
-			fit_col = fit_row,
-			bit_col = m_cell_backbuffer.cbegin()
-					+ std::distance(m_cell_frontbuffer.begin(), fit_row),
-			cseq_f = 0u,
-			cseq_e = 0u
-			; fit_col != fit_row_n
-			; ++fit_col, ++bit_col, ++cseq_e
-		) {
-			if (BEARD_TERMINAL_CELL_CMP(*fit_col, *bit_col)) {
-				// Cell differs from the front buffer cell;
-				// reposition if necessary and render cell
-				if (cseq_f == cseq_e) {
-					// This cell is the head of the sequence;
-					// reposition
-					terminal_internal::repos_out(
-						m_stream_out,
-						std::distance(fit_row, fit_col),
-						row
-					);
-				}
-				terminal_internal::write_attrs(
-					*this,
-					bit_col->attr_fg,
-					bit_col->attr_bg
-				);
-				m_stream_out.write(
-					bit_col->u8block.units,
-					bit_col->u8block.size()
-				);
-			} else if (cseq_f != cseq_e) {
-				// Previous cell was last in differing sequence; copy
-				// all cells in sequence to front buffer
-				std::copy(bit_row + cseq_f, bit_col, fit_row + cseq_f);
-				cseq_f = cseq_e + 1u;
-			} else {
-				// Previous cell did not differ; increment first iter
-				// for copy sequence to track bit_col (ergo, prevent
-				// above branch on next iteration)
-				++cseq_f;
+		// Only the dirty span can differ from the front buffer
+		auto x = unsigned_cast(it_dirty->x0);
+		auto const x_end = unsigned_cast(it_dirty->x1);
+		for (;;) {
+			x += diff.find_differ(fit_row + x, bit_row + x, x_end - x);
+			if (x_end == x) {
+				break;
+			}
+			auto run_end
+				= x + diff.find_equal(fit_row + x, bit_row + x, x_end - x);
+			// Wide cells are written whole
+			if (0u < x && tty::is_continuation(bit_row[x])) {
+				--x;
+			}
+			if (
+				unsigned_cast(m_tty_size.width) > run_end &&
+				tty::is_continuation(bit_row[run_end])
+			) {
+				++run_end;
 			}
+
+			// Render the run of differing cells and copy what was
+			// rendered to the front buffer
+			auto const written_end = unsigned_cast(terminal_internal::write_run(
+				*this, bit_row, row,
+				static_cast<geom_value_type>(x),
+				static_cast<geom_value_type>(run_end)
+			));
+			std::copy(bit_row + x, bit_row + written_end, fit_row + x);
+			if (x_end <= written_end) {
+				break;
+			}
+			x = written_end;
 		}
-		if (cseq_f != cseq_e) {
-			// Handle terminating copy sequence
-			std::copy(bit_row + cseq_f, bit_col, fit_row + cseq_f);
+		it_dirty->reset();
+		m_row_hashes[row].front_valid = false;
+	}
+	if (hashed) {
+		// Every row of the front buffer now matches the back buffer
+		for (auto& row_hash : m_row_hashes) {
+			row_hash.front = row_hash.back;
+			row_hash.front_valid = true;
 		}
-		(*it_dirty) = false;
 	}
 	m_states.disable(State::backbuffer_dirty);
 
 	// Reset to the caret position
 	terminal_internal::repos_out(
-		m_stream_out, m_caret_pos.x, m_caret_pos.y
+		*this, m_caret_pos.x, m_caret_pos.y
 	);
 	terminal_internal::flush(*this);
 }
@@ -1386,7 +3456,10 @@ Terminal::clear_back(
 ) noexcept {
 	terminal_internal::clear_buffer(m_cell_backbuffer, cell);
 	m_states.enable(State::backbuffer_dirty);
-	std::fill(m_dirty_rows.begin(), m_dirty_rows.end(), true);
+	std::fill(
+		m_dirty_rows.begin(), m_dirty_rows.end(),
+		DirtySpan{0, m_tty_size.width}
+	);
 }
 
 void
@@ -1407,32 +3480,116 @@ Terminal::clear_back(
 		if (clamped.size.width == 0 || clamped.size.height == 0) {
 			return;
 		}
-		auto it_dirty = m_dirty_rows.begin() + clamped.pos.y;
+		// Store the whole rect and mark it dirty in bulk; present()
+		// skips cells that did not actually change
+		auto const& kernel = tty::diff_kernel();
+		auto const it_dirty = m_dirty_rows.begin() + clamped.pos.y;
 		auto it_row
-			= m_cell_backbuffer.begin()
+			= m_cell_backbuffer.data()
 			+ (clamped.pos.y * m_tty_size.width)
 			+ clamped.pos.x;
-		auto const it_row_e = it_row + (clamped.size.height * m_tty_size.width);
-		bool row_dirtied = false;
-		bool state_dirtied = false;
-		for (; it_row < it_row_e; it_row += m_tty_size.width, ++it_dirty) {
-			auto const it_row_stride = it_row + clamped.size.width;
-			for (auto it = it_row; it != it_row_stride; ++it) {
-				if (BEARD_TERMINAL_CELL_CMP(*it, cell)) {
-					std::copy(&cell, &cell + 1u, it);
-					row_dirtied = true;
+		if (clamped.size.width == m_tty_size.width) {
+			// Whole rows are contiguous
+			kernel.fill(
+				it_row,
+				unsigned_cast(clamped.size.width * clamped.size.height),
+				cell
+			);
+			std::fill(
+				it_dirty, it_dirty + clamped.size.height,
+				DirtySpan{0, m_tty_size.width}
+			);
+		} else {
+			geom_value_type const x1 = clamped.pos.x + clamped.size.width;
+			auto const it_dirty_e = it_dirty + clamped.size.height;
+			for (
+				auto it = it_dirty;
+				it_dirty_e != it;
+				++it, it_row += m_tty_size.width
+			) {
+				kernel.fill(it_row, unsigned_cast(clamped.size.width), cell);
+				it->add(clamped.pos.x, x1);
+			}
+			for (
+				geom_value_type y = clamped.pos.y;
+				clamped.pos.y + clamped.size.height > y;
+				++y
+			) {
+				terminal_internal::repair_back_split(*this, y, clamped.pos.x);
+				terminal_internal::repair_back_split(*this, y, x1);
+			}
+		}
+		m_states.enable(State::backbuffer_dirty);
+	}
+}
+
+bool
+Terminal::scroll_region(
+	Rect const& rect,
+	geom_value_type const lines
+) {
+	Quad quad = rect_abs_quad(rect);
+	vec2_clamp_min(quad.v1, Vec2{0, 0});
+	vec2_clamp_max(quad.v2, m_tty_size);
+	vec2_clamp_min(quad.v2, quad.v1);
+	Rect const clamped = quad_rect(quad);
+	geom_value_type const count = (0 > lines) ? -lines : lines;
+	if (0 == count || 0 == clamped.size.width || 0 == clamped.size.height) {
+		return false;
+	} else if (clamped.size.height <= count) {
+		// Every row is exposed
+		clear_back(clamped);
+		return false;
+	}
+
+	geom_value_type const
+		x1 = clamped.pos.x + clamped.size.width,
+		top = clamped.pos.y,
+		bottom = clamped.pos.y + clamped.size.height
+	;
+	bool const scrolled
+		= is_open()
+		&& m_tty_size.width == clamped.size.width
+		&& terminal_internal::scroll_out(*this, top, bottom, lines)
+	;
+	terminal_internal::shift_rows(
+		m_cell_backbuffer, m_tty_size.width, clamped, lines
+	);
+	if (scrolled) {
+		// The front buffer follows the screen, so cells can only
+		// differ where they did before the shift; exposed rows are
+		// cleared in both buffers
+		terminal_internal::shift_rows(
+			m_cell_frontbuffer, m_tty_size.width, clamped, lines
+		);
+		terminal_internal::invalidate_front_hashes(*this, top, bottom);
+		if (0 < lines) {
+			for (geom_value_type y = top; bottom - count > y; ++y) {
+				auto const& src = m_dirty_rows[y + count];
+				if (!src.empty()) {
+					m_dirty_rows[y].add(src.x0, src.x1);
 				}
 			}
-			if (row_dirtied) {
-				(*it_dirty) = true;
-				state_dirtied = true;
-				row_dirtied = false;
+		} else {
+			for (geom_value_type y = bottom; top + count < y--;) {
+				auto const& src = m_dirty_rows[y - count];
+				if (!src.empty()) {
+					m_dirty_rows[y].add(src.x0, src.x1);
+				}
 			}
 		}
-		if (state_dirtied) {
-			m_states.enable(State::backbuffer_dirty);
+	} else {
+		for (geom_value_type y = top; bottom > y; ++y) {
+			m_dirty_rows[y].add(clamped.pos.x, x1);
+			// Wide cells on the edges of the rect are split from the
+			// half that did not move
+			terminal_internal::repair_back_split(*this, y, clamped.pos.x);
+			terminal_internal::repair_back_split(*this, y, x1);
 		}
 	}
+	// Scroll output is flushed by present()
+	m_states.enable(State::backbuffer_dirty);
+	return scrolled;
 }
 
 // events
@@ -1495,14 +3652,14 @@ Terminal::poll(
 void
 Terminal::update_cache() {
 	// Cache caps
-	tty::TerminalInfo::cap_string_map_type::const_iterator cap_it;
+	tty::CapStringValue cap_value{};
 	for (
 		unsigned idx = 0u;
 		enum_cast(Terminal::CapCache::COUNT) > idx;
 		++idx
 	) {
-		if (m_info.lookup_cap_string(s_cap_cache_table[idx], cap_it)) {
-			m_cap_cache[idx].assign(cap_it->second);
+		if (m_info.lookup_cap_string(s_cap_cache_table[idx], cap_value)) {
+			m_cap_cache[idx].assign(cap_value.data, cap_value.size);
 		} else {
 			m_cap_cache[idx].clear();
 			BEARD_DEBUG_MSG_FQN_F(
@@ -1513,6 +3670,111 @@ Terminal::update_cache() {
 		}
 	}
 
+	// Compile parametrized caps
+	for (
+		unsigned idx = 0u;
+		enum_cast(Terminal::ParmCap::COUNT) > idx;
+		++idx
+	) {
+		auto& program = m_parm_programs[idx];
+		if (!m_info.lookup_cap_string(s_parm_table[idx], cap_value)) {
+			program.clear();
+			BEARD_DEBUG_MSG_FQN_F(
+				"missing parametrized cap: %u (CapString) %u (ParmCap)",
+				s_parm_table[idx],
+				idx
+			);
+		} else if (!program.compile(String{cap_value.data, cap_value.size})) {
+			BEARD_DEBUG_MSG_FQN_F(
+				"malformed parametrized cap: %u (CapString) %u (ParmCap)",
+				s_parm_table[idx],
+				idx
+			);
+		}
+	}
+	terminal_internal::clear_parm_cache(*this);
+
+	// Attribute changes can only be composed into a single SGR
+	// sequence if the terminal's attribute caps are plain SGR
+	auto const cap_is = [this](
+		CapCache const cap,
+		char const* const value
+	) -> bool {
+		return 0 == m_cap_cache[enum_cast(cap)].compare(value);
+	};
+	auto const& sgr0 = m_cap_cache[enum_cast(CapCache::exit_attribute_mode)];
+	m_states.set(
+		State::cap_ansi_sgr,
+		(
+			(3u <= sgr0.size() && 0 == sgr0.compare(sgr0.size() - 3u, 3u, "\033[m")) ||
+			(4u <= sgr0.size() && 0 == sgr0.compare(sgr0.size() - 4u, 4u, "\033[0m"))
+		) &&
+		cap_is(CapCache::enter_bold_mode, "\033[1m") &&
+		cap_is(CapCache::enter_underline_mode, "\033[4m") &&
+		cap_is(CapCache::enter_reverse_mode, "\033[7m") &&
+		cap_is(CapCache::enter_blink_mode, "\033[5m")
+	);
+
+	// Synchronized updates are known to be supported if the Sync
+	// extended cap writes the same mode 2026 sequences as
+	// begin_sync() and flush()
+	m_states.set(
+		State::cap_ext_sync,
+		m_info.lookup_ext_cap_string("Sync", cap_value) &&
+		terminal_internal::ext_sync_is_mode_2026(cap_value)
+	);
+
+	// Cursor movement is written directly if cursor_address and
+	// parm_right_cursor are plain CUP and CUF
+	m_states.set(
+		State::cap_ansi_cursor_address,
+		m_info.lookup_cap_string(tty::CapString::cursor_address, cap_value) &&
+		cap_value.equals("\033[%i%p1%d;%p2%dH")
+	);
+	m_states.set(
+		State::cap_ansi_parm_right_cursor,
+		m_info.lookup_cap_string(tty::CapString::parm_right_cursor, cap_value) &&
+		cap_value.equals("\033[%p1%dC")
+	);
+
+	// Scroll regions are written directly if change_scroll_region is
+	// plain DECSTBM
+	m_states.set(
+		State::cap_ansi_scroll_region,
+		m_info.lookup_cap_string(tty::CapString::change_scroll_region, cap_value) &&
+		cap_value.equals("\033[%i%p1%d;%p2%dr")
+	);
+
+	// Uniform runs can be erased or repeated if the caps are plain
+	// EL, ECH and REP
+	m_states.set(
+		State::cap_ansi_clr_eol,
+		m_info.lookup_cap_string(tty::CapString::clr_eol, cap_value) &&
+		cap_value.equals("\033[K")
+	);
+	m_states.set(
+		State::cap_ansi_erase_chars,
+		m_info.lookup_cap_string(tty::CapString::erase_chars, cap_value) &&
+		cap_value.equals("\033[%p1%dX")
+	);
+	m_states.set(
+		State::cap_ansi_repeat_char,
+		m_info.lookup_cap_string(tty::CapString::repeat_char, cap_value) &&
+		cap_value.equals("%p1%c\033[%p2%{1}%-%db")
+	);
+	m_states.set(
+		State::cap_back_color_erase,
+		m_info.cap_flag(tty::CapFlag::back_color_erase)
+	);
+
+	// Writing to the last column either leaves the cursor there
+	// until the next character (xenl) or wraps immediately
+	m_states.set(
+		State::cap_deferred_wrap,
+		!m_info.cap_flag(tty::CapFlag::auto_right_margin) ||
+		m_info.cap_flag(tty::CapFlag::eat_newline_glitch)
+	);
+
 	// TODO: Should colors be disabled if the terminal says they're
 	// not supported? (What if it's lying to us!?)
 	// NB: Assuming terminal is capable of at least 8 colors
@@ -1522,6 +3784,23 @@ Terminal::update_cache() {
 		? 8u
 		: static_cast<unsigned>(max_colors)
 	;
+	// The RGB extended cap (any type) means direct color even if
+	// max_colors was clamped to fit the legacy number format
+	m_states.set(State::cap_ext_rgb, m_info.has_ext_cap("RGB"));
+	if (m_states.test(State::cap_ext_rgb)) {
+		m_cap_max_colors = max_ce(
+			m_cap_max_colors,
+			unsigned{direct_color_count}
+		);
+	}
+	// Colors can be composed with other attributes if the color caps
+	// are plain SGR
+	m_states.set(
+		State::cap_ansi_color,
+		terminal_internal::color_caps_are_sgr(*this)
+	);
+	// Cached attribute sequences depend on the caps
+	terminal_internal::clear_sgr_cache(*this);
 
 	// Cache key decoding graph
 	m_key_decode_graph.resize(
@@ -1529,12 +3808,12 @@ Terminal::update_cache() {
 	);
 	for (auto const kmap : s_input_keymap) {
 		if (static_cast<tty::CapString>(-1) != kmap.cap) {
-			if (m_info.lookup_cap_string(kmap.cap, cap_it)) {
-				if (!cap_it->second.empty()) {
+			if (m_info.lookup_cap_string(kmap.cap, cap_value)) {
+				if (!cap_value.empty()) {
 					terminal_internal::add_key_cap(
 						m_key_decode_graph, 0,
-						cap_it->second.data(),
-						cap_it->second.data() + cap_it->second.size(),
+						cap_value.data,
+						cap_value.data + cap_value.size,
 						kmap.mod, kmap.code, kmap.cp
 					);
 				} else {
@@ -1664,6 +3943,33 @@ Terminal::open(
 }
 #undef BEARD_SCOPE_FUNC
 
+#define BEARD_SCOPE_FUNC open_headless
+void
+Terminal::open_headless(
+	Vec2 const& size
+) {
+	BEARD_TERMINAL_CHECK_OPEN_ERRORS_();
+
+	m_ev_pending.reset();
+	m_headless_size = size;
+	m_headless_input.clear();
+	m_headless_output.clear();
+	m_states.enable(State::headless);
+
+	put_cap_cache(CapCache::enter_ca_mode);
+	put_cap_cache(CapCache::keypad_xmit);
+	(is_caret_visible())
+		? put_cap_cache(CapCache::cursor_normal)
+		: put_cap_cache(CapCache::cursor_invisible)
+	;
+	update_size();
+	terminal_internal::flush(*this);
+	if (m_states.test(State::sync_output)) {
+		terminal_internal::probe_sync_output(*this);
+	}
+}
+#undef BEARD_SCOPE_FUNC
+
 #define BEARD_SCOPE_FUNC close
 void
 Terminal::close() noexcept {
@@ -1674,13 +3980,16 @@ Terminal::close() noexcept {
 	deinit();
 	terminal_internal::close_fd(m_tty_fd);
 	m_tty_fd = tty::FD_INVALID;
+	m_states.disable(State::headless);
 }
 #undef BEARD_SCOPE_FUNC
 
 #define BEARD_SCOPE_FUNC update_size
 bool
 Terminal::update_size() {
-	if (is_open()) {
+	if (is_headless()) {
+		return resize(m_headless_size.width, m_headless_size.height);
+	} else if (is_open()) {
 		struct ::winsize ws;
 		if (0 == ::ioctl(m_tty_fd, TIOCGWINSZ, &ws)) {
 			return resize(ws.ws_col, ws.ws_row);
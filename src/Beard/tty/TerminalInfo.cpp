@@ -4,45 +4,31 @@
 
 #include <Beard/tty/TerminalInfo.hpp>
 
-#include <duct/EndianUtils.hpp>
-#include <duct/IO/arithmetic.hpp>
-#include <duct/IO/unicode.hpp>
-
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#include <algorithm>
 #include <istream>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include <Beard/detail/gr_ceformat.hpp>
 
 namespace Beard {
 namespace tty {
 
-// class TerminalInfo implementation
-
-#define BEARD_SCOPE_CLASS tty::TerminalInfo
-
-TerminalInfo::~TerminalInfo() noexcept = default;
-
-TerminalInfo::TerminalInfo() noexcept
-	: m_initialized(false)
-	, m_names()
-	, m_cap_flags()
-	, m_cap_numbers()
-	, m_cap_strings()
-{}
-
-TerminalInfo::TerminalInfo(TerminalInfo&&) noexcept = default;
-TerminalInfo::TerminalInfo(TerminalInfo const&) = default;
-TerminalInfo& TerminalInfo::operator=(TerminalInfo&&) noexcept = default;
-
-// serialization
-
-// TODO: <tic.h> specifies some differences:
-// 1. max names field size is 512 (XSI);
-// 2. there are two different "signed" values specifying
-//	  different meanings for capabilities;
+// TODO: <tic.h> specifies that there are two different "signed"
+// values specifying different meanings for capabilities
 
 // terminfo format:
 /*
-	uint16_t magic = 0x011a
+	Integers are little-endian. number_t is int16_t if magic is
+	0x011a, or int32_t if magic is 0x021e.
+
+	uint16_t magic
 
 	uint16_t names_size
 	uint16_t flag_count
@@ -58,25 +44,52 @@ TerminalInfo& TerminalInfo::operator=(TerminalInfo&&) noexcept = default;
 
 	// Seek ahead to align to 2-byte word (ergo: possible dead byte)
 
-	uint16_t numbers[number_count]
+	number_t numbers[number_count]
 
 	// Offsets are relative to string_table
 	uint16_t string_offsets[string_offset_count]
 	char string_table[string_table_size]
+
+	// ncurses extended section (optional)
+
+	// Seek ahead to align to 2-byte word
+
+	uint16_t ext_flag_count
+	uint16_t ext_number_count
+	uint16_t ext_string_count
+	// Number of strings (values and names) in ext_string_table
+	uint16_t ext_string_used_count
+	uint16_t ext_string_table_size
+
+	uint8_t ext_flags[ext_flag_count]
+
+	// Seek ahead to align to 2-byte word
+
+	number_t ext_numbers[ext_number_count]
+
+	// Values, relative to ext_string_table; then names of the
+	// flags, numbers and strings, relative to the end of the last
+	// value in ext_string_table
+	uint16_t ext_string_offsets[
+		ext_string_count
+		+ ext_flag_count + ext_number_count + ext_string_count
+	]
+	char ext_string_table[ext_string_table_size]
 */
 
 namespace {
 enum : unsigned {
 	terminfo_magic = 0x011a,
-	terminfo_max_names_size = 128u,
+	terminfo_magic_32 = 0x021e,
+	// XSI; ncurses entries can exceed the historical 128
+	terminfo_max_names_size = 512u,
+	terminfo_header_size = 12u,
+	terminfo_ext_header_size = 10u,
 
 	terminfo_table_offset_empty = 0xFFFFu,
 	mask_offset_signbit = 0x8000,
 };
 
-constexpr auto const
-terminfo_endian = duct::Endian::little;
-
 struct terminfo_header {
 	std::uint16_t magic{0};
 	std::uint16_t names_size{0};
@@ -85,62 +98,370 @@ struct terminfo_header {
 	std::uint16_t string_offset_count{0};
 	std::uint16_t string_table_size{0};
 };
+
+struct terminfo_ext_header {
+	std::uint16_t flag_count{0};
+	std::uint16_t number_count{0};
+	std::uint16_t string_count{0};
+	std::uint16_t string_used_count{0};
+	std::uint16_t string_table_size{0};
+};
+
+inline unsigned
+read_u16(
+	std::uint8_t const* const p
+) noexcept {
+	return
+		static_cast<unsigned>(p[0u]) |
+		static_cast<unsigned>(p[1u]) << 8u
+	;
+}
+
+inline terminfo_header
+read_header(
+	std::uint8_t const* const p
+) noexcept {
+	terminfo_header hdr{};
+	hdr.magic = static_cast<std::uint16_t>(read_u16(p + 0u));
+	hdr.names_size = static_cast<std::uint16_t>(read_u16(p + 2u));
+	hdr.flag_count = static_cast<std::uint16_t>(read_u16(p + 4u));
+	hdr.number_count = static_cast<std::uint16_t>(read_u16(p + 6u));
+	hdr.string_offset_count = static_cast<std::uint16_t>(read_u16(p + 8u));
+	hdr.string_table_size = static_cast<std::uint16_t>(read_u16(p + 10u));
+	return hdr;
+}
+
+inline terminfo_ext_header
+read_ext_header(
+	std::uint8_t const* const p
+) noexcept {
+	terminfo_ext_header hdr{};
+	hdr.flag_count = static_cast<std::uint16_t>(read_u16(p + 0u));
+	hdr.number_count = static_cast<std::uint16_t>(read_u16(p + 2u));
+	hdr.string_count = static_cast<std::uint16_t>(read_u16(p + 4u));
+	hdr.string_used_count = static_cast<std::uint16_t>(read_u16(p + 6u));
+	hdr.string_table_size = static_cast<std::uint16_t>(read_u16(p + 8u));
+	return hdr;
+}
+
+inline unsigned
+number_size(
+	terminfo_header const& hdr
+) noexcept {
+	return terminfo_magic_32 == hdr.magic ? 4u : 2u;
+}
+
+// Size of the legacy section described by hdr
+inline std::size_t
+entry_size(
+	terminfo_header const& hdr
+) noexcept {
+	std::size_t const numbers_pos
+		= terminfo_header_size + hdr.names_size + hdr.flag_count
+	;
+	return
+		numbers_pos + (numbers_pos % 2u)
+		+ number_size(hdr) * hdr.number_count
+		+ 2u * hdr.string_offset_count
+		+ hdr.string_table_size
+	;
+}
+
+// Size of the extended section described by ext_hdr, including
+// its header
+inline std::size_t
+ext_entry_size(
+	terminfo_ext_header const& ext_hdr,
+	unsigned const number_size
+) noexcept {
+	return
+		terminfo_ext_header_size
+		+ ext_hdr.flag_count + (ext_hdr.flag_count % 2u)
+		+ number_size * ext_hdr.number_count
+		// Every capability has a name; strings also have a value
+		+ 2u * (
+			ext_hdr.flag_count
+			+ ext_hdr.number_count
+			+ 2u * ext_hdr.string_count
+		)
+		+ ext_hdr.string_table_size
+	;
+}
+
+// Size of the prefix of table whose strings are terminated
+inline unsigned
+terminated_size(
+	std::uint8_t const* const table,
+	unsigned size
+) noexcept {
+	while (0u < size && '\0' != table[size - 1u]) {
+		--size;
+	}
+	return size;
+}
 } // anonymous namespace
 
-#define BEARD_TERMINFO_CHECK_IO_ERROR_(m_)				\
-	if (stream.fail()) {								\
-		BEARD_THROW_FQN(								\
-			ErrorCode::serialization_io_failed,			\
-			m_											\
-		);												\
+// class TerminalInfo implementation
+
+#define BEARD_SCOPE_CLASS tty::TerminalInfo
+
+TerminalInfo::~TerminalInfo() noexcept {
+	release();
+}
+
+TerminalInfo::TerminalInfo() noexcept
+	: m_initialized(false)
+	, m_names()
+	, m_map()
+	, m_buffer()
+	, m_data(nullptr)
+	, m_layout()
+	, m_ext_caps()
+{
+	std::fill_n(
+		m_string_offsets,
+		enum_cast(tty::CapString::COUNT),
+		string_offset_none
+	);
+}
+
+TerminalInfo::TerminalInfo(
+	TerminalInfo&& other
+) noexcept
+	: m_initialized(other.m_initialized)
+	, m_names(std::move(other.m_names))
+	, m_map(std::move(other.m_map))
+	, m_buffer(std::move(other.m_buffer))
+	, m_data(m_map ? m_map.get() : m_buffer.data())
+	, m_layout(other.m_layout)
+	, m_ext_caps(std::move(other.m_ext_caps))
+{
+	std::copy_n(
+		other.m_string_offsets,
+		enum_cast(tty::CapString::COUNT),
+		m_string_offsets
+	);
+	other.release();
+}
+
+TerminalInfo::TerminalInfo(
+	TerminalInfo const& other
+)
+	: m_initialized(other.m_initialized)
+	, m_names(other.m_names)
+	// The mapping is read-only, so it can be shared
+	, m_map(other.m_map)
+	, m_buffer(
+		other.m_map
+		? aux::vector<std::uint8_t>{}
+		: other.m_buffer
+	)
+	, m_data(m_map ? m_map.get() : m_buffer.data())
+	, m_layout(other.m_layout)
+	, m_ext_caps(other.m_ext_caps)
+{
+	std::copy_n(
+		other.m_string_offsets,
+		enum_cast(tty::CapString::COUNT),
+		m_string_offsets
+	);
+}
+
+TerminalInfo&
+TerminalInfo::operator=(
+	TerminalInfo&& other
+) noexcept {
+	if (this != &other) {
+		release();
+		m_initialized = other.m_initialized;
+		m_names = std::move(other.m_names);
+		m_map = std::move(other.m_map);
+		m_buffer = std::move(other.m_buffer);
+		m_data = m_map ? m_map.get() : m_buffer.data();
+		m_layout = other.m_layout;
+		m_ext_caps = std::move(other.m_ext_caps);
+		std::copy_n(
+			other.m_string_offsets,
+			enum_cast(tty::CapString::COUNT),
+			m_string_offsets
+		);
+		other.release();
 	}
-//
+	return *this;
+}
 
-#define BEARD_SCOPE_FUNC deserialize
+void
+TerminalInfo::release() noexcept {
+	m_map.reset();
+	m_initialized = false;
+	m_names.clear();
+	m_buffer.clear();
+	m_data = nullptr;
+	m_layout = Layout{};
+	std::fill_n(
+		m_string_offsets,
+		enum_cast(tty::CapString::COUNT),
+		string_offset_none
+	);
+	m_ext_caps.clear();
+}
+
+// capabilities
+
+tty::CapNumberValue
+TerminalInfo::read_number(
+	std::size_t const pos
+) const noexcept {
+	auto const p = m_data + pos;
+	if (2u == m_layout.number_size) {
+		return static_cast<std::int16_t>(read_u16(p));
+	}
+	return static_cast<std::int32_t>(
+		static_cast<std::uint32_t>(read_u16(p)) |
+		static_cast<std::uint32_t>(read_u16(p + 2u)) << 16u
+	);
+}
+
+tty::CapNumberValue
+TerminalInfo::cap_number(
+	tty::CapNumber const cap
+) const noexcept {
+	if (m_layout.number_count <= enum_cast(cap)) {
+		return tty::CAP_NUMBER_NOT_SUPPORTED;
+	}
+	return read_number(
+		m_layout.numbers + m_layout.number_size * enum_cast(cap)
+	);
+}
+
+bool
+TerminalInfo::cap_string(
+	tty::CapString const cap,
+	String& value
+) const {
+	tty::CapStringValue cap_value{};
+	if (lookup_cap_string(cap, cap_value)) {
+		value.assign(cap_value.data, cap_value.size);
+		return true;
+	}
+	return false;
+}
+
+// extended capabilities
+
+TerminalInfo::ExtCap const*
+TerminalInfo::find_ext_cap(
+	char const* const name
+) const noexcept {
+	auto const table = m_data + m_layout.ext_string_table;
+	auto const it = std::lower_bound(
+		m_ext_caps.cbegin(), m_ext_caps.cend(), name,
+		[table](ExtCap const& cap, char const* const name) -> bool {
+			return 0 > std::strcmp(
+				reinterpret_cast<char const*>(table + cap.name), name
+			);
+		}
+	);
+	if (
+		m_ext_caps.cend() == it ||
+		0 != std::strcmp(reinterpret_cast<char const*>(table + it->name), name)
+	) {
+		return nullptr;
+	}
+	return &*it;
+}
+
+tty::CapFlagValue
+TerminalInfo::ext_cap_flag(
+	char const* const name
+) const noexcept {
+	auto const cap = find_ext_cap(name);
+	return
+		nullptr != cap &&
+		ExtKind::flag == cap->kind &&
+		0u != cap->value
+	;
+}
+
+tty::CapNumberValue
+TerminalInfo::ext_cap_number(
+	char const* const name
+) const noexcept {
+	auto const cap = find_ext_cap(name);
+	if (nullptr == cap || ExtKind::number != cap->kind) {
+		return tty::CAP_NUMBER_NOT_SUPPORTED;
+	}
+	return read_number(
+		m_layout.ext_numbers + m_layout.number_size * cap->value
+	);
+}
+
+bool
+TerminalInfo::lookup_ext_cap_string(
+	char const* const name,
+	tty::CapStringValue& value
+) const noexcept {
+	auto const cap = find_ext_cap(name);
+	if (
+		nullptr == cap ||
+		ExtKind::string != cap->kind ||
+		string_offset_none == cap->value
+	) {
+		return false;
+	}
+	value.data = reinterpret_cast<char const*>(
+		m_data + m_layout.ext_string_table + cap->value
+	);
+	value.size = std::strlen(value.data);
+	return true;
+}
+
+// serialization
+
+#define BEARD_SCOPE_FUNC parse
 namespace {
 BEARD_DEF_FMT_FQN(
 	s_err_bad_magic,
-	"bad magic encountered: expected %-#04x, got %-#04x"
+	"bad magic encountered: expected %-#04x or %-#04x, got %-#04x"
 );
 BEARD_DEF_FMT_FQN(
 	s_err_name_too_large,
 	"names section too large: expected s <= %u, got s = %u"
 );
+BEARD_DEF_FMT_FQN(
+	s_err_truncated,
+	"entry truncated: expected %u bytes, got %u"
+);
 BEARD_DEF_FMT_FQN(
 	s_err_string_offset_invalid,
 	"index %u offset %u overflows string table (size = %u)"
 );
+BEARD_DEF_FMT_FQN(
+	s_err_string_unterminated,
+	"index %u offset %u is not terminated in string table"
+);
 } // anonymous namespace
 
 void
-TerminalInfo::deserialize(
-	std::istream& stream
+TerminalInfo::parse(
+	std::size_t const size
 ) {
-	m_initialized = false;
-	m_names.clear();
-	m_cap_flags.clear();
-	m_cap_numbers.clear();
-	m_cap_strings.clear();
-
-	terminfo_header hdr{};
-
-	// header
-	duct::IO::read_arithmetic(stream, hdr.magic, terminfo_endian);
-	duct::IO::read_arithmetic(stream, hdr.names_size, terminfo_endian);
-	duct::IO::read_arithmetic(stream, hdr.flag_count, terminfo_endian);
-	duct::IO::read_arithmetic(stream, hdr.number_count, terminfo_endian);
-	duct::IO::read_arithmetic(stream, hdr.string_offset_count, terminfo_endian);
-	duct::IO::read_arithmetic(stream, hdr.string_table_size, terminfo_endian);
-
-	BEARD_TERMINFO_CHECK_IO_ERROR_(
-		"failed to read header"
-	);
+	if (terminfo_header_size > size) {
+		BEARD_THROW_FMT(
+			ErrorCode::serialization_data_malformed,
+			s_err_truncated,
+			static_cast<unsigned>(terminfo_header_size),
+			static_cast<unsigned>(size)
+		);
+	}
+	terminfo_header const hdr = read_header(m_data);
 
-	if (terminfo_magic != hdr.magic) {
+	if (terminfo_magic != hdr.magic && terminfo_magic_32 != hdr.magic) {
 		BEARD_THROW_FMT(
 			ErrorCode::serialization_data_malformed,
 			s_err_bad_magic,
 			static_cast<unsigned>(terminfo_magic),
+			static_cast<unsigned>(terminfo_magic_32),
 			static_cast<unsigned>(hdr.magic)
 		);
 	}
@@ -154,24 +475,41 @@ TerminalInfo::deserialize(
 		);
 	}
 
+	if (entry_size(hdr) > size) {
+		BEARD_THROW_FMT(
+			ErrorCode::serialization_data_malformed,
+			s_err_truncated,
+			static_cast<unsigned>(entry_size(hdr)),
+			static_cast<unsigned>(size)
+		);
+	}
+
+	// layout
+	Layout layout{};
+	layout.size = entry_size(hdr);
+	layout.flags = terminfo_header_size + hdr.names_size;
+	// names_size and flag_count will indicate unalignment if
+	// their sum is uneven because their respective elements are
+	// bytes.
+	layout.numbers = layout.flags + hdr.flag_count;
+	layout.numbers += layout.numbers % 2u;
+	layout.number_size = number_size(hdr);
+	std::size_t const string_offsets
+		= layout.numbers + layout.number_size * hdr.number_count
+	;
+	layout.string_table = string_offsets + 2u * hdr.string_offset_count;
+	layout.flag_count = hdr.flag_count;
+	layout.number_count = hdr.number_count;
+
 	// names
 	// Assuming ASCII encoding -- compatible with UTF-8, so no
 	// decoding necessary.
-
-	String names_glob{};
-	duct::IO::read_string_copy(
-		stream,
-		names_glob,
-		static_cast<std::size_t>(hdr.names_size),
-		terminfo_endian
-	);
-	BEARD_TERMINFO_CHECK_IO_ERROR_(
-		"failed to read names field"
-	);
-
-	if (0u < names_glob.size() && '\0' == *names_glob.crbegin()) {
-		names_glob.pop_back();
-	}
+	auto const names_begin
+		= reinterpret_cast<char const*>(m_data + terminfo_header_size)
+	;
+	String names_glob{names_begin, std::find(
+		names_begin, names_begin + hdr.names_size, '\0'
+	)};
 
 	String::size_type pos = 0u, next = String::npos;
 	for (;;) {
@@ -189,82 +527,17 @@ TerminalInfo::deserialize(
 		}
 	}
 
-	// flags
-	m_cap_flags.resize(static_cast<std::size_t>(hdr.flag_count));
-	duct::IO::read_arithmetic_array(
-		stream,
-		m_cap_flags.data(),
-		m_cap_flags.size(),
-		terminfo_endian
-	);
-	BEARD_TERMINFO_CHECK_IO_ERROR_(
-		"failed to read flag section"
-	);
-
-	// align
-	// names_size and flag_count will indicate unalignment if
-	// their sum is uneven because their respective elements are
-	// bytes.
-	if ((hdr.names_size + hdr.flag_count) % 2) {
-		char dead_byte;
-		stream.read(&dead_byte, 1u);
-		BEARD_TERMINFO_CHECK_IO_ERROR_(
-			"failed to read dead byte for alignment"
-		);
-	}
-
-	// numbers
-	m_cap_numbers.resize(static_cast<std::size_t>(hdr.number_count));
-	duct::IO::read_arithmetic_array(
-		stream,
-		m_cap_numbers.data(),
-		m_cap_numbers.size(),
-		terminfo_endian
-	);
-	BEARD_TERMINFO_CHECK_IO_ERROR_(
-		"failed to read number section"
-	);
-
 	// string offsets
-	aux::vector<std::uint16_t> string_offsets(
-		static_cast<std::size_t>(hdr.string_offset_count)
-	);
-	duct::IO::read_arithmetic_array(
-		stream,
-		string_offsets.data(),
-		string_offsets.size(),
-		terminfo_endian
-	);
-	BEARD_TERMINFO_CHECK_IO_ERROR_(
-		"failed to read string offsets section"
+	// Every string must be terminated within the table so that
+	// lookups needn't be checked. Offsets are decoded into the
+	// dense table; capabilities past string_offset_count are absent.
+	unsigned const terminated = terminated_size(
+		m_data + layout.string_table, hdr.string_table_size
 	);
-
-	// string table
-	// Again assuming ASCII.
-	aux::vector<char> string_table(
-		static_cast<std::size_t>(hdr.string_table_size)
-	);
-	duct::IO::read(
-		stream,
-		string_table.data(),
-		string_table.size()
-	);
-	BEARD_TERMINFO_CHECK_IO_ERROR_(
-		"failed to read string table"
-	);
-
-	unsigned index = 0u, offset = 0u;
-	auto
-		it_start = string_table.cend(),
-		it_cnull = it_start
-	;
-	for (
-		auto it = string_offsets.cbegin();
-		string_offsets.cend() != it;
-		++it, ++index
-	) {
-		offset = static_cast<unsigned>(*it);
-
+	for (unsigned index = 0u; hdr.string_offset_count > index; ++index) {
+		unsigned const offset = read_u16(
+			m_data + string_offsets + 2u * index
+		);
 		// -1 means terminal does not support capability, and
 		// "other negative values are illegal".
 		// And in Unix fashion, /you will get illegal values/.
@@ -274,30 +547,312 @@ TerminalInfo::deserialize(
 		) {
 			continue;
 		}
+		if (hdr.string_table_size <= offset) {
+			BEARD_THROW_FMT(
+				ErrorCode::serialization_data_malformed,
+				s_err_string_offset_invalid,
+				index,
+				offset,
+				static_cast<unsigned>(hdr.string_table_size)
+			);
+		} else if (terminated <= offset) {
+			BEARD_THROW_FMT(
+				ErrorCode::serialization_data_malformed,
+				s_err_string_unterminated,
+				index,
+				offset
+			);
+		}
+		++layout.string_count;
+		if (enum_cast(tty::CapString::COUNT) > index) {
+			m_string_offsets[index] = static_cast<std::uint16_t>(offset);
+		}
+	}
+
+	m_layout = layout;
+
+	// extended section
+	std::size_t const ext_pos = layout.size + (layout.size % 2u);
+	if (ext_pos + terminfo_ext_header_size <= size) {
+		parse_ext(ext_pos, size);
+	}
+	m_initialized = true;
+}
+
+void
+TerminalInfo::parse_ext(
+	std::size_t const pos,
+	std::size_t const size
+) {
+	terminfo_ext_header const ext_hdr = read_ext_header(m_data + pos);
+	std::size_t const ext_size
+		= ext_entry_size(ext_hdr, m_layout.number_size)
+	;
+	if (pos + ext_size > size) {
+		BEARD_THROW_FMT(
+			ErrorCode::serialization_data_malformed,
+			s_err_truncated,
+			static_cast<unsigned>(pos + ext_size),
+			static_cast<unsigned>(size)
+		);
+	}
 
-		if (string_table.size() <= offset) {
+	unsigned const name_count
+		= ext_hdr.flag_count
+		+ ext_hdr.number_count
+		+ ext_hdr.string_count
+	;
+
+	std::size_t const flags = pos + terminfo_ext_header_size;
+	std::size_t const numbers
+		= flags + ext_hdr.flag_count + (ext_hdr.flag_count % 2u)
+	;
+	std::size_t const string_offsets
+		= numbers + m_layout.number_size * ext_hdr.number_count
+	;
+	std::size_t const string_table
+		= string_offsets + 2u * (ext_hdr.string_count + name_count)
+	;
+	auto const table = m_data + string_table;
+	unsigned const terminated = terminated_size(
+		table, ext_hdr.string_table_size
+	);
+	auto const check_offset = [&](
+		unsigned const index,
+		unsigned const offset
+	) {
+		if (ext_hdr.string_table_size <= offset) {
 			BEARD_THROW_FMT(
 				ErrorCode::serialization_data_malformed,
 				s_err_string_offset_invalid,
 				index,
 				offset,
-				string_table.size()
+				static_cast<unsigned>(ext_hdr.string_table_size)
+			);
+		} else if (terminated <= offset) {
+			BEARD_THROW_FMT(
+				ErrorCode::serialization_data_malformed,
+				s_err_string_unterminated,
+				index,
+				offset
+			);
+		}
+	};
+
+	// Names are interned as offsets into the string table, and
+	// values are kept in place
+	m_ext_caps.resize(name_count);
+	unsigned index = 0u;
+	for (; ext_hdr.flag_count > index; ++index) {
+		m_ext_caps[index].kind = ExtKind::flag;
+		m_ext_caps[index].value = m_data[flags + index];
+	}
+	for (unsigned number = 0u; ext_hdr.number_count > number; ++number) {
+		m_ext_caps[index].kind = ExtKind::number;
+		m_ext_caps[index].value = static_cast<std::uint16_t>(number);
+		++index;
+	}
+	// Names follow the last value
+	unsigned names_base = 0u;
+	for (unsigned string = 0u; ext_hdr.string_count > string; ++string) {
+		unsigned const offset = read_u16(
+			m_data + string_offsets + 2u * string
+		);
+		m_ext_caps[index].kind = ExtKind::string;
+		m_ext_caps[index].value = string_offset_none;
+		if (0u == (mask_offset_signbit & offset)) {
+			check_offset(string, offset);
+			m_ext_caps[index].value = static_cast<std::uint16_t>(offset);
+			names_base = max_ce(names_base, static_cast<unsigned>(
+				offset + 1u + std::strlen(
+					reinterpret_cast<char const*>(table + offset)
+				)
+			));
+		}
+		++index;
+	}
+	for (index = 0u; name_count > index; ++index) {
+		unsigned const string = ext_hdr.string_count + index;
+		unsigned const offset = read_u16(
+			m_data + string_offsets + 2u * string
+		);
+		check_offset(string, names_base + offset);
+		m_ext_caps[index].name = static_cast<std::uint16_t>(
+			names_base + offset
+		);
+	}
+	std::sort(
+		m_ext_caps.begin(), m_ext_caps.end(),
+		[table](ExtCap const& x, ExtCap const& y) -> bool {
+			return 0 > std::strcmp(
+				reinterpret_cast<char const*>(table + x.name),
+				reinterpret_cast<char const*>(table + y.name)
 			);
 		}
+	);
+
+	m_layout.size = pos + ext_size;
+	m_layout.ext_numbers = numbers;
+	m_layout.ext_string_table = string_table;
+}
+#undef BEARD_SCOPE_FUNC
+
+#define BEARD_SCOPE_FUNC load
+namespace {
+BEARD_DEF_FMT_FQN_CERR(
+	s_err_load_open_failed,
+	"failed to open terminfo file `%s`"
+);
+BEARD_DEF_FMT_FQN_CERR(
+	s_err_load_map_failed,
+	"failed to map terminfo file `%s`"
+);
+} // anonymous namespace
 
-		it_start = string_table.cbegin() + offset;
-		it_cnull = std::find(
-			it_start,
-			string_table.cend(),
-			'\0'
+void
+TerminalInfo::load(
+	String const& path
+) {
+	release();
+
+	signed const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (-1 == fd) {
+		BEARD_THROW_FMT_CERR(
+			ErrorCode::serialization_io_failed,
+			s_err_load_open_failed,
+			errno,
+			path
+		);
+	}
+
+	struct ::stat stat_buf{};
+	if (0 != ::fstat(fd, &stat_buf)) {
+		auto const err = errno;
+		::close(fd);
+		BEARD_THROW_FMT_CERR(
+			ErrorCode::serialization_io_failed,
+			s_err_load_map_failed,
+			err,
+			path
+		);
+	}
+	auto const size = static_cast<std::size_t>(stat_buf.st_size);
+	if (terminfo_header_size > size) {
+		::close(fd);
+		BEARD_THROW_FQN(
+			ErrorCode::serialization_data_malformed,
+			"file is too small to hold a header"
 		);
-		m_cap_strings.emplace(
-			index,
-			String{it_start, it_cnull}
+	}
+
+	void* const map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	auto const err = errno;
+	::close(fd);
+	if (MAP_FAILED == map) {
+		BEARD_THROW_FMT_CERR(
+			ErrorCode::serialization_io_failed,
+			s_err_load_map_failed,
+			err,
+			path
 		);
 	}
+	// The mapping is unmapped if this throws
+	m_map.reset(
+		static_cast<std::uint8_t const*>(map),
+		[size](std::uint8_t const* const data) {
+			::munmap(const_cast<std::uint8_t*>(data), size);
+		}
+	);
+	m_data = m_map.get();
 
-	m_initialized = true;
+	try {
+		parse(size);
+	} catch (...) {
+		release();
+		throw;
+	}
+}
+#undef BEARD_SCOPE_FUNC
+
+#define BEARD_TERMINFO_CHECK_IO_ERROR_(m_)				\
+	if (stream.fail()) {								\
+		BEARD_THROW_FQN(								\
+			ErrorCode::serialization_io_failed,			\
+			m_											\
+		);												\
+	}
+//
+
+#define BEARD_SCOPE_FUNC deserialize
+void
+TerminalInfo::deserialize(
+	std::istream& stream
+) try {
+	release();
+
+	// header
+	m_buffer.resize(terminfo_header_size);
+	stream.read(
+		reinterpret_cast<char*>(m_buffer.data()),
+		static_cast<std::streamsize>(terminfo_header_size)
+	);
+	BEARD_TERMINFO_CHECK_IO_ERROR_(
+		"failed to read header"
+	);
+
+	// Only the entry is read; it is validated by parse()
+	terminfo_header const hdr = read_header(m_buffer.data());
+	bool const magic_valid
+		=  terminfo_magic == hdr.magic
+		|| terminfo_magic_32 == hdr.magic
+	;
+	std::size_t size
+		= magic_valid
+		? entry_size(hdr)
+		: terminfo_header_size
+	;
+	auto const read_to = [this, &stream](
+		std::size_t const from,
+		std::size_t const to
+	) {
+		m_buffer.resize(to);
+		stream.read(
+			reinterpret_cast<char*>(m_buffer.data()) + from,
+			static_cast<std::streamsize>(to - from)
+		);
+		return unsigned_cast(stream.gcount()) == to - from;
+	};
+	read_to(terminfo_header_size, size);
+	BEARD_TERMINFO_CHECK_IO_ERROR_(
+		"failed to read entry"
+	);
+
+	// The extended section is optional; the stream ending before
+	// its header is not an error
+	std::size_t const ext_pos = size + (size % 2u);
+	if (
+		magic_valid &&
+		read_to(size, ext_pos + terminfo_ext_header_size)
+	) {
+		std::size_t const ext_size = ext_entry_size(
+			read_ext_header(m_buffer.data() + ext_pos),
+			number_size(hdr)
+		);
+		size = ext_pos + ext_size;
+		read_to(ext_pos + terminfo_ext_header_size, size);
+		BEARD_TERMINFO_CHECK_IO_ERROR_(
+			"failed to read extended section"
+		);
+	} else {
+		m_buffer.resize(size);
+		stream.clear(stream.rdstate() & ~std::ios_base::failbit);
+	}
+
+	m_data = m_buffer.data();
+	parse(size);
+} catch (...) {
+	release();
+	throw;
 }
 #undef BEARD_SCOPE_FUNC
 
@@ -0,0 +1,200 @@
+/**
+@copyright MIT license; see @ref index or the accompanying LICENSE file.
+*/
+
+#include <Beard/tty/TerminalInfoCache.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#include <sys/stat.h>
+
+namespace Beard {
+namespace tty {
+
+// class TerminalInfoCache implementation
+
+#define BEARD_SCOPE_CLASS tty::TerminalInfoCache
+
+namespace {
+static char const* const
+s_system_dirs[]{
+	"/etc/terminfo",
+	"/lib/terminfo",
+	"/usr/share/terminfo",
+};
+} // anonymous namespace
+
+TerminalInfoCache::~TerminalInfoCache() noexcept = default;
+
+TerminalInfoCache::TerminalInfoCache()
+	: m_mutex()
+	, m_entries()
+	, m_hits(0u)
+	, m_misses(0u)
+{}
+
+TerminalInfoCache&
+TerminalInfoCache::process() {
+	static TerminalInfoCache s_cache{};
+	return s_cache;
+}
+
+TerminalInfoCache::Stats
+TerminalInfoCache::stats() const {
+	std::lock_guard<std::mutex> lock{m_mutex};
+	return {m_hits, m_misses, m_entries.size()};
+}
+
+bool
+TerminalInfoCache::locate(
+	String const& name,
+	String& path
+) {
+	// Names come from the environment or from clients; they must
+	// not be able to name a path outside the directories
+	if (
+		name.empty() ||
+		'.' == name[0u] ||
+		String::npos != name.find('/')
+	) {
+		return false;
+	}
+
+	static char const s_hex_digits[] = "0123456789abcdef";
+	auto const first = static_cast<unsigned char>(name[0u]);
+	char const hex[]{
+		s_hex_digits[first >> 4u],
+		s_hex_digits[first & 0x0Fu],
+		'\0'
+	};
+	char const letter[]{name[0u], '\0'};
+	char const* const subdirs[]{letter, hex};
+
+	auto const search = [&name, &path, &subdirs](
+		char const* const dir,
+		std::size_t const size
+	) -> bool {
+		if (0u == size) {
+			return false;
+		}
+		struct ::stat stat_buf{};
+		for (auto const subdir : subdirs) {
+			path.assign(dir, size);
+			path.append(1u, '/').append(subdir);
+			path.append(1u, '/').append(name);
+			if (
+				0 == ::stat(path.c_str(), &stat_buf) &&
+				S_ISREG(stat_buf.st_mode)
+			) {
+				return true;
+			}
+		}
+		return false;
+	};
+
+	char const* const terminfo = std::getenv("TERMINFO");
+	if (nullptr != terminfo && search(terminfo, std::strlen(terminfo))) {
+		return true;
+	}
+
+	char const* const home = std::getenv("HOME");
+	if (nullptr != home && '\0' != home[0u]) {
+		String const home_dir = String{home} + "/.terminfo";
+		if (search(home_dir.data(), home_dir.size())) {
+			return true;
+		}
+	}
+
+	// Empty components are skipped; the system directories follow
+	char const* dirs = std::getenv("TERMINFO_DIRS");
+	while (nullptr != dirs && '\0' != *dirs) {
+		char const* const end = std::strchr(dirs, ':');
+		std::size_t const size
+			= nullptr != end
+			? static_cast<std::size_t>(end - dirs)
+			: std::strlen(dirs)
+		;
+		if (search(dirs, size)) {
+			return true;
+		}
+		dirs = nullptr != end ? end + 1 : nullptr;
+	}
+
+	for (auto const dir : s_system_dirs) {
+		if (search(dir, std::strlen(dir))) {
+			return true;
+		}
+	}
+	path.clear();
+	return false;
+}
+
+TerminalInfoCache::info_pointer_type
+TerminalInfoCache::find(
+	String const& name
+) {
+	aux::shared_ptr<Entry> entry;
+	{
+		std::lock_guard<std::mutex> lock{m_mutex};
+		auto const it = m_entries.find(name);
+		if (m_entries.cend() != it) {
+			++m_hits;
+			entry = it->second;
+		} else {
+			++m_misses;
+			entry = aux::make_shared<Entry>();
+			m_entries.emplace(name, entry);
+		}
+	}
+
+	std::lock_guard<std::mutex> entry_lock{entry->mutex};
+	if (entry->loaded) {
+		return entry->info;
+	}
+	// Entries that aren't loaded are dropped, so names that aren't
+	// found aren't cached and failed loads are retried
+	auto const drop = [this, &name, &entry]() {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		auto const it = m_entries.find(name);
+		if (m_entries.cend() != it && entry == it->second) {
+			m_entries.erase(it);
+		}
+	};
+	String path{};
+	if (!locate(name, path)) {
+		drop();
+		return nullptr;
+	}
+	auto info = aux::make_shared<tty::TerminalInfo>();
+	try {
+		info->load(path);
+	} catch (...) {
+		drop();
+		throw;
+	}
+	entry->info = std::move(info);
+	entry->loaded = true;
+	return entry->info;
+}
+
+TerminalInfoCache::info_pointer_type
+TerminalInfoCache::find_term() {
+	char const* const term = std::getenv("TERM");
+	if (nullptr == term) {
+		return nullptr;
+	}
+	return find(String{term});
+}
+
+void
+TerminalInfoCache::clear() {
+	std::lock_guard<std::mutex> lock{m_mutex};
+	m_entries.clear();
+}
+
+#undef BEARD_SCOPE_CLASS
+
+} // namespace tty
+} // namespace Beard
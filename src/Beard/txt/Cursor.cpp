@@ -3,6 +3,7 @@
 */
 
 #include <Beard/utility.hpp>
+#include <Beard/txt/UTF8.hpp>
 #include <Beard/txt/Cursor.hpp>
 
 #include <duct/char.hpp>
@@ -157,7 +158,7 @@ Cursor::assign(
 	auto const pcount = signed_cast(node.points());
 	node.m_buffer.assign(str, str + size);
 	auto const new_pcount = signed_cast(
-		txt::EncUtils::count(str, str + size, false)
+		txt::utf8_kernel().count_points(str, size)
 	);
 	tree().update_counts(
 		node,
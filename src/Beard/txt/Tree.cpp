@@ -4,8 +4,10 @@
 
 #include <Beard/utility.hpp>
 #include <Beard/txt/Defs.hpp>
+#include <Beard/txt/UTF8.hpp>
 #include <Beard/txt/Tree.hpp>
 
+#include <cstring>
 #include <utility>
 #include <iterator>
 
@@ -19,26 +21,30 @@ Tree::Tree(
 )
 	: m_nodes()
 {
-	auto first = str.cbegin(), last = first;
-	std::size_t pcount = 0u;
-	for (; str.cend() > last;) {
-		if ('\n' == *last) {
-			m_nodes.emplace_back(std::move(txt::Node{&*first, &*last, pcount}));
-			m_ucount += unsigned_cast(std::distance(first, last));
-			m_pcount += pcount;
-			++last;
-			first = last;
-			pcount = 0u;
-		} else {
-			last += txt::EncUtils::required_first_whole(*last);
-			++pcount;
+	auto const& utf8 = txt::utf8_kernel();
+	auto first = str.data();
+	auto const end = str.data() + str.size();
+	for (;;) {
+		auto const last = static_cast<char8 const*>(
+			std::memchr(first, '\n', unsigned_cast(end - first))
+		);
+		if (nullptr == last) {
+			break;
 		}
+		std::size_t const pcount
+			= utf8.count_points(first, unsigned_cast(last - first));
+		m_nodes.emplace_back(std::move(txt::Node{first, last, pcount}));
+		m_ucount += unsigned_cast(last - first);
+		m_pcount += pcount;
+		first = last + 1;
 	}
-	if (0u < pcount) {
-		m_nodes.emplace_back(std::move(txt::Node{&*first, &*last, pcount}));
-		m_ucount += unsigned_cast(std::distance(first, last));
+	if (end > first) {
+		std::size_t const pcount
+			= utf8.count_points(first, unsigned_cast(end - first));
+		m_nodes.emplace_back(std::move(txt::Node{first, end, pcount}));
+		m_ucount += unsigned_cast(end - first);
 		m_pcount += pcount;
-	} else if (m_nodes.empty() || !str.empty()) {
+	} else {
 		m_nodes.emplace_back();
 	}
 }
@@ -0,0 +1,608 @@
+/**
+@copyright MIT license; see @ref index or the accompanying LICENSE file.
+*/
+
+#include <Beard/config.hpp>
+#include <Beard/utility.hpp>
+#include <Beard/txt/Defs.hpp>
+#include <Beard/txt/UTF8.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define BEARD_TXT_UTF8_X86
+	#include <immintrin.h>
+#endif
+
+namespace Beard {
+namespace txt {
+
+namespace {
+
+using char_type = txt::EncUtils::char_type;
+
+inline static unsigned
+unit(
+	char_type const c
+) noexcept {
+	return static_cast<unsigned char>(c);
+}
+
+inline static bool
+is_continuation(
+	char_type const c
+) noexcept {
+	return 0x80u == (unit(c) & 0xC0u);
+}
+
+// Size of the valid sequence at data, or 0 if it is invalid or
+// incomplete
+static std::size_t
+sequence_size(
+	char_type const* const data,
+	std::size_t const size
+) noexcept {
+	unsigned const lead = unit(data[0u]);
+	// Bounds of the second unit
+	unsigned low = 0x80u;
+	unsigned high = 0xBFu;
+	std::size_t seq_size;
+	if (0x80u > lead) {
+		return 1u;
+	} else if (0xC2u > lead) {
+		// Continuation unit or overlong 2-unit lead
+		return 0u;
+	} else if (0xE0u > lead) {
+		seq_size = 2u;
+	} else if (0xF0u > lead) {
+		seq_size = 3u;
+		if (0xE0u == lead) {
+			// Overlong
+			low = 0xA0u;
+		} else if (0xEDu == lead) {
+			// Surrogate
+			high = 0x9Fu;
+		}
+	} else if (0xF5u > lead) {
+		seq_size = 4u;
+		if (0xF0u == lead) {
+			// Overlong
+			low = 0x90u;
+		} else if (0xF4u == lead) {
+			// Above U+10FFFF
+			high = 0x8Fu;
+		}
+	} else {
+		return 0u;
+	}
+	if (
+		seq_size > size ||
+		low > unit(data[1u]) ||
+		high < unit(data[1u])
+	) {
+		return 0u;
+	}
+	for (std::size_t index = 2u; seq_size > index; ++index) {
+		if (!is_continuation(data[index])) {
+			return 0u;
+		}
+	}
+	return seq_size;
+}
+
+// Start of the last sequence that starts before index (or 0). Vector
+// validators have checked everything before it.
+static std::size_t
+last_sequence_start(
+	char_type const* const data,
+	std::size_t const index
+) noexcept {
+	if (0u == index) {
+		return 0u;
+	}
+	std::size_t start = index - 1u;
+	for (
+		; 0u < start && 4u > index - start && is_continuation(data[start]);
+		--start
+	) {}
+	return start;
+}
+
+// Validate with an ASCII fast path; non-ASCII sequences are checked
+// one at a time
+template<
+	std::size_t (&ascii_prefix)(char_type const*, std::size_t)
+>
+inline static std::size_t
+mixed_valid_prefix(
+	char_type const* const data,
+	std::size_t const size
+) noexcept {
+	std::size_t index = 0u;
+	while (size > index) {
+		index += ascii_prefix(data + index, size - index);
+		if (size == index) {
+			break;
+		}
+		std::size_t const seq_size = sequence_size(data + index, size - index);
+		if (0u == seq_size) {
+			break;
+		}
+		index += seq_size;
+	}
+	return index;
+}
+
+// scalar
+
+enum : std::uint64_t {
+	high_bits = 0x8080808080808080u,
+	low_bits = 0x0101010101010101u,
+};
+
+static std::size_t
+scalar_ascii_prefix(
+	char_type const* const data,
+	std::size_t const size
+) noexcept {
+	std::size_t index = 0u;
+	// Eight units at a time; the unit that ends the prefix is found
+	// below
+	for (; size - index >= 8u; index += 8u) {
+		std::uint64_t word;
+		std::memcpy(&word, data + index, 8u);
+		if (0u != (word & high_bits)) {
+			break;
+		}
+	}
+	for (; size > index && 0x80u > unit(data[index]); ++index) {}
+	return index;
+}
+
+static std::size_t
+scalar_valid_prefix(
+	char_type const* const data,
+	std::size_t const size
+) noexcept {
+	return mixed_valid_prefix<scalar_ascii_prefix>(data, size);
+}
+
+static std::size_t
+scalar_count_points(
+	char_type const* const data,
+	std::size_t const size
+) noexcept {
+	std::size_t count = 0u;
+	std::size_t index = 0u;
+	for (; size - index >= 8u; index += 8u) {
+		std::uint64_t word;
+		std::memcpy(&word, data + index, 8u);
+		// One bit for each 10xxxxxx unit, summed into the top byte
+		std::uint64_t const continuations
+			= ((word & ~(word << 1u)) & high_bits) >> 7u;
+		count += 8u - static_cast<std::size_t>((continuations * low_bits) >> 56u);
+	}
+	for (; size > index; ++index) {
+		count += !is_continuation(data[index]);
+	}
+	return count;
+}
+
+#ifdef BEARD_TXT_UTF8_X86
+
+// SSE2
+
+__attribute__((target("sse2")))
+static std::size_t
+sse2_ascii_prefix(
+	char_type const* const data,
+	std::size_t const size
+) noexcept {
+	std::size_t index = 0u;
+	for (; size - index >= 16u; index += 16u) {
+		unsigned const mask = static_cast<unsigned>(_mm_movemask_epi8(
+			_mm_loadu_si128(reinterpret_cast<__m128i const*>(data + index))
+		));
+		if (0u != mask) {
+			return index + static_cast<std::size_t>(__builtin_ctz(mask));
+		}
+	}
+	return index + scalar_ascii_prefix(data + index, size - index);
+}
+
+__attribute__((target("sse2")))
+static std::size_t
+sse2_count_points(
+	char_type const* const data,
+	std::size_t const size
+) noexcept {
+	// Units above -65 (0xBF) as signed bytes are not continuation
+	// units. Each lane counts in 8 bits, so the lanes are summed
+	// before they can overflow.
+	__m128i const threshold = _mm_set1_epi8(-65);
+	__m128i sums = _mm_setzero_si128();
+	std::size_t index = 0u;
+	while (size - index >= 16u) {
+		__m128i counts = _mm_setzero_si128();
+		for (
+			unsigned round = 0u;
+			255u > round && size - index >= 16u;
+			++round, index += 16u
+		) {
+			__m128i const v = _mm_loadu_si128(
+				reinterpret_cast<__m128i const*>(data + index)
+			);
+			counts = _mm_sub_epi8(counts, _mm_cmpgt_epi8(v, threshold));
+		}
+		sums = _mm_add_epi64(sums, _mm_sad_epu8(counts, _mm_setzero_si128()));
+	}
+	std::uint64_t lanes[2u];
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), sums);
+	return
+		static_cast<std::size_t>(lanes[0u] + lanes[1u]) +
+		scalar_count_points(data + index, size - index)
+	;
+}
+
+// AVX2
+
+__attribute__((target("avx2")))
+static std::size_t
+avx2_ascii_prefix(
+	char_type const* const data,
+	std::size_t const size
+) noexcept {
+	std::size_t index = 0u;
+	for (; size - index >= 32u; index += 32u) {
+		unsigned const mask = static_cast<unsigned>(_mm256_movemask_epi8(
+			_mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + index))
+		));
+		if (0u != mask) {
+			return index + static_cast<std::size_t>(__builtin_ctz(mask));
+		}
+	}
+	return index + sse2_ascii_prefix(data + index, size - index);
+}
+
+// Error classes of a unit pair (Keiser & Lemire, "Validating UTF-8
+// in less than one instruction per byte"), looked up by the nibbles
+// of the first unit and the high nibble of the second. A pair is
+// valid if the three classes share no bits, except that the 3rd and
+// 4th units of a sequence must share exactly two_conts.
+enum : unsigned {
+	too_short = 1u << 0u,
+	too_long = 1u << 1u,
+	overlong_3 = 1u << 2u,
+	too_large = 1u << 3u,
+	surrogate = 1u << 4u,
+	overlong_2 = 1u << 5u,
+	// Shared: the second unit is 1000xxxx
+	too_large_1000 = 1u << 6u,
+	overlong_4 = 1u << 6u,
+	two_conts = 1u << 7u,
+	carry = too_short | too_long | two_conts,
+};
+
+__attribute__((target("avx2")))
+inline static __m256i
+avx2_table(
+	unsigned const (&t)[16u]
+) noexcept {
+	return _mm256_broadcastsi128_si256(_mm_setr_epi8(
+		static_cast<char>(t[ 0u]), static_cast<char>(t[ 1u]),
+		static_cast<char>(t[ 2u]), static_cast<char>(t[ 3u]),
+		static_cast<char>(t[ 4u]), static_cast<char>(t[ 5u]),
+		static_cast<char>(t[ 6u]), static_cast<char>(t[ 7u]),
+		static_cast<char>(t[ 8u]), static_cast<char>(t[ 9u]),
+		static_cast<char>(t[10u]), static_cast<char>(t[11u]),
+		static_cast<char>(t[12u]), static_cast<char>(t[13u]),
+		static_cast<char>(t[14u]), static_cast<char>(t[15u])
+	));
+}
+
+static unsigned const
+s_first_high[16u]{
+	// 0xxxxxxx: ASCII
+	too_long, too_long, too_long, too_long,
+	too_long, too_long, too_long, too_long,
+	// 10xxxxxx: continuation
+	two_conts, two_conts, two_conts, two_conts,
+	// 1100xxxx
+	too_short | overlong_2,
+	// 1101xxxx
+	too_short,
+	// 1110xxxx
+	too_short | overlong_3 | surrogate,
+	// 1111xxxx
+	too_short | too_large | too_large_1000 | overlong_4,
+},
+s_first_low[16u]{
+	// xxxx0000
+	carry | overlong_3 | overlong_2 | overlong_4,
+	// xxxx0001
+	carry | overlong_2,
+	// xxxx001x
+	carry,
+	carry,
+	// xxxx0100
+	carry | too_large,
+	// xxxx0101 and above
+	carry | too_large | too_large_1000,
+	carry | too_large | too_large_1000,
+	carry | too_large | too_large_1000,
+	carry | too_large | too_large_1000,
+	carry | too_large | too_large_1000,
+	carry | too_large | too_large_1000,
+	carry | too_large | too_large_1000,
+	carry | too_large | too_large_1000,
+	// xxxx1101
+	carry | too_large | too_large_1000 | surrogate,
+	carry | too_large | too_large_1000,
+	carry | too_large | too_large_1000,
+},
+s_second_high[16u]{
+	// 0xxxxxxx
+	too_short, too_short, too_short, too_short,
+	too_short, too_short, too_short, too_short,
+	// 1000xxxx
+	too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4,
+	// 1001xxxx
+	too_long | overlong_2 | two_conts | overlong_3 | too_large,
+	// 101xxxxx
+	too_long | overlong_2 | two_conts | surrogate | too_large,
+	too_long | overlong_2 | two_conts | surrogate | too_large,
+	// 11xxxxxx
+	too_short, too_short, too_short, too_short,
+};
+
+// The units of input shifted in by n from the end of prev
+#define BEARD_TXT_AVX2_PREV_(input_, prev_, n_)					\
+	_mm256_alignr_epi8(											\
+		input_, _mm256_permute2x128_si256(prev_, input_, 0x21),	\
+		16 - (n_)												\
+	)
+
+__attribute__((target("avx2")))
+static std::size_t
+avx2_valid_prefix(
+	char_type const* const data,
+	std::size_t const size
+) noexcept {
+	__m256i const first_high = avx2_table(s_first_high);
+	__m256i const first_low = avx2_table(s_first_low);
+	__m256i const second_high = avx2_table(s_second_high);
+	__m256i const nibble = _mm256_set1_epi8(0x0F);
+	__m256i const third_min = _mm256_set1_epi8(0xE0 - 0x80);
+	__m256i const fourth_min = _mm256_set1_epi8(0xF0 - 0x80);
+	__m256i const high_bit = _mm256_set1_epi8(static_cast<char>(0x80));
+	// Units at or above these in the last three places start a
+	// sequence that doesn't fit
+	__m256i const last_max = _mm256_setr_epi8(
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		static_cast<char>(0xF0 - 1),
+		static_cast<char>(0xE0 - 1),
+		static_cast<char>(0xC0 - 1)
+	);
+
+	__m256i prev_input = _mm256_setzero_si256();
+	__m256i prev_incomplete = _mm256_setzero_si256();
+	std::size_t index = 0u;
+	for (; size - index >= 32u; index += 32u) {
+		__m256i const input = _mm256_loadu_si256(
+			reinterpret_cast<__m256i const*>(data + index)
+		);
+		__m256i error;
+		if (0 == _mm256_movemask_epi8(input)) {
+			// ASCII is only an error if it cuts off a sequence
+			error = prev_incomplete;
+			prev_incomplete = _mm256_setzero_si256();
+		} else {
+			__m256i const prev1 = BEARD_TXT_AVX2_PREV_(input, prev_input, 1);
+			__m256i const classes = _mm256_and_si256(
+				_mm256_and_si256(
+					_mm256_shuffle_epi8(
+						first_high,
+						_mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)
+					),
+					_mm256_shuffle_epi8(first_low, _mm256_and_si256(prev1, nibble))
+				),
+				_mm256_shuffle_epi8(
+					second_high,
+					_mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)
+				)
+			);
+			// 3rd and 4th units must be continuations, which is the
+			// only case where two_conts is expected
+			__m256i const expect_conts = _mm256_and_si256(
+				_mm256_or_si256(
+					_mm256_subs_epu8(
+						BEARD_TXT_AVX2_PREV_(input, prev_input, 2), third_min
+					),
+					_mm256_subs_epu8(
+						BEARD_TXT_AVX2_PREV_(input, prev_input, 3), fourth_min
+					)
+				),
+				high_bit
+			);
+			error = _mm256_xor_si256(expect_conts, classes);
+			prev_incomplete = _mm256_subs_epu8(input, last_max);
+		}
+		if (!_mm256_testz_si256(error, error)) {
+			break;
+		}
+		prev_input = input;
+	}
+	// The sequence cut off by the last block, the tail and any error
+	// are found by the scalar scan
+	std::size_t const start = last_sequence_start(data, index);
+	return start + scalar_valid_prefix(data + start, size - start);
+}
+
+#undef BEARD_TXT_AVX2_PREV_
+
+__attribute__((target("avx2")))
+static std::size_t
+avx2_count_points(
+	char_type const* const data,
+	std::size_t const size
+) noexcept {
+	// See sse2_count_points()
+	__m256i const threshold = _mm256_set1_epi8(-65);
+	__m256i sums = _mm256_setzero_si256();
+	std::size_t index = 0u;
+	while (size - index >= 32u) {
+		__m256i counts = _mm256_setzero_si256();
+		for (
+			unsigned round = 0u;
+			255u > round && size - index >= 32u;
+			++round, index += 32u
+		) {
+			__m256i const v = _mm256_loadu_si256(
+				reinterpret_cast<__m256i const*>(data + index)
+			);
+			counts = _mm256_sub_epi8(counts, _mm256_cmpgt_epi8(v, threshold));
+		}
+		sums = _mm256_add_epi64(
+			sums, _mm256_sad_epu8(counts, _mm256_setzero_si256())
+		);
+	}
+	std::uint64_t lanes[4u];
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), sums);
+	return
+		static_cast<std::size_t>(lanes[0u] + lanes[1u] + lanes[2u] + lanes[3u]) +
+		sse2_count_points(data + index, size - index)
+	;
+}
+
+#define BEARD_TXT_UTF8_X86_FUNCS_(name_) \
+	name_ ## _ascii_prefix, name_ ## _valid_prefix, name_ ## _count_points
+
+#define BEARD_TXT_UTF8_X86_SSE2_FUNCS_ \
+	sse2_ascii_prefix, scalar_valid_prefix, sse2_count_points
+
+#else
+
+#define BEARD_TXT_UTF8_X86_SSE2_FUNCS_ \
+	scalar_ascii_prefix, scalar_valid_prefix, scalar_count_points
+
+#define BEARD_TXT_UTF8_X86_FUNCS_(name_) \
+	scalar_ascii_prefix, scalar_valid_prefix, scalar_count_points
+
+#endif // BEARD_TXT_UTF8_X86
+
+static txt::UTF8Kernel const
+s_kernels[]{
+	{
+		txt::UTF8Impl::scalar, "scalar",
+		scalar_ascii_prefix, scalar_valid_prefix, scalar_count_points
+	},
+	// SSE2 has no byte shuffle to classify non-ASCII units with, and
+	// skipping ASCII blocks with it is slower than the scalar scan on
+	// mixed text
+	{
+		txt::UTF8Impl::sse2, "sse2",
+		BEARD_TXT_UTF8_X86_SSE2_FUNCS_
+	},
+	{txt::UTF8Impl::avx2, "avx2", BEARD_TXT_UTF8_X86_FUNCS_(avx2)},
+};
+
+#undef BEARD_TXT_UTF8_X86_FUNCS_
+#undef BEARD_TXT_UTF8_X86_SSE2_FUNCS_
+
+static_assert(
+	enum_cast(txt::UTF8Impl::COUNT)
+	== std::extent<decltype(s_kernels)>::value,
+	"s_kernels is not the correct size"
+);
+
+} // anonymous namespace
+
+bool
+utf8_supported(
+	txt::UTF8Impl const impl
+) noexcept {
+#ifdef BEARD_TXT_UTF8_X86
+	__builtin_cpu_init();
+#endif
+	switch (impl) {
+	case txt::UTF8Impl::scalar:
+		return true;
+
+#ifdef BEARD_TXT_UTF8_X86
+	case txt::UTF8Impl::sse2:
+		return __builtin_cpu_supports("sse2");
+
+	case txt::UTF8Impl::avx2:
+		return __builtin_cpu_supports("avx2");
+#endif
+
+	default:
+		return false;
+	}
+}
+
+txt::UTF8Kernel const&
+utf8_kernel(
+	txt::UTF8Impl const impl
+) noexcept {
+	return s_kernels[enum_cast(impl)];
+}
+
+txt::UTF8Kernel const&
+utf8_kernel() noexcept {
+	static txt::UTF8Kernel const* const s_best = []() noexcept {
+		unsigned impl = enum_cast(txt::UTF8Impl::COUNT);
+		do {
+			--impl;
+		} while (!utf8_supported(static_cast<txt::UTF8Impl>(impl)));
+		return &s_kernels[impl];
+	}();
+	return *s_best;
+}
+
+std::size_t
+sequence_width(
+	txt::Sequence const& seq
+) noexcept {
+	auto const& kernel = txt::utf8_kernel();
+	std::size_t width = 0u;
+	std::size_t index = 0u;
+	while (seq.size > index) {
+		std::size_t const ascii
+			= kernel.ascii_prefix(seq.data + index, seq.size - index);
+		width += ascii;
+		index += ascii;
+		if (seq.size == index) {
+			break;
+		}
+		std::size_t seq_size
+			= sequence_size(seq.data + index, seq.size - index);
+		if (0u == seq_size) {
+			// The invalid unit and the continuation units after it
+			// are replaced by U+FFFD
+			for (
+				seq_size = 1u;
+				txt::EncUtils::max_units > seq_size &&
+				seq.size > index + seq_size &&
+				is_continuation(seq.data[index + seq_size]);
+				++seq_size
+			) {}
+			width += 1u;
+		} else {
+			char32 cp;
+			txt::EncUtils::decode(
+				seq.data + index, seq.data + index + seq_size,
+				cp, duct::CHAR_REPLACEMENT
+			);
+			width += txt::code_point_width(cp);
+		}
+		index += seq_size;
+	}
+	return width;
+}
+
+} // namespace txt
+} // namespace Beard
@@ -28,14 +28,45 @@ Field::update_view() noexcept {
 		m_view.col_extent(txt::Extent::head);
 	} else {
 		auto const& frame = geometry().frame();
-		auto const inner_width = max_ce(0, frame.size.width - 2 - 1);
+		auto const inner_width = unsigned_cast(
+			max_ce(geom_value_type{0}, frame.size.width - 2)
+		);
+		auto const& node = m_cursor.node();
+		auto const width_between = [&node](
+			txt::Cursor const& from,
+			txt::Cursor const& to
+		) -> unsigned {
+			return static_cast<unsigned>(txt::sequence_width({
+				&*node.cbegin() + from.index(),
+				unsigned_cast(to.index() - from.index())
+			}));
+		};
+		// The caret covers the code point under the cursor, which
+		// may be wide, or a column past the end of the text
+		txt::Cursor next{m_cursor};
+		next.col_next();
+		auto const cursor_width = max_ce(1u, width_between(m_cursor, next));
 		if (
-			m_view.col() > m_cursor.col() ||
-			m_view.col() + inner_width < m_cursor.col()
+			m_view.index() > m_cursor.index() ||
+			width_between(m_view, m_cursor) + cursor_width > inner_width
 		) {
-			m_view.col_abs(
-				m_cursor.col() - (inner_width / 2)
-			);
+			// Center the cursor by stepping back as many columns as
+			// fit in half of the rest
+			unsigned const half
+				= (inner_width > cursor_width ? inner_width - cursor_width : 0u)
+				/ 2u
+			;
+			unsigned width = 0u;
+			m_view = m_cursor;
+			while (0 < m_view.col()) {
+				txt::Cursor prev{m_view};
+				prev.col_prev();
+				width += width_between(prev, m_view);
+				if (half < width) {
+					break;
+				}
+				m_view = prev;
+			}
 		}
 	}
 }
@@ -178,24 +209,22 @@ Field::render_impl(
 	);
 	rd.terminal.put_cell(frame.pos.x, frame.pos.y, cell_end);
 	auto const inner_width = max_ce(geom_value_type{0}, frame.size.width - 2);
-	auto const put_count = min_ce(
-		static_cast<txt::Cursor::difference_type>(inner_width),
-		max_ce(
+	txt::Sequence const view_seq{
+		&*node.cbegin() + m_view.index(),
+		unsigned_cast(max_ce(
 			txt::Cursor::difference_type{0},
-			signed_cast(node.points()) - m_view.col()
-		)
+			signed_cast(node.units()) - m_view.index()
+		))
+	};
+	auto const put_count = min_ce(
+		inner_width,
+		static_cast<geom_value_type>(txt::sequence_width(view_seq))
 	);
 	rd.terminal.put_sequence(
 		frame.pos.x + 1,
 		frame.pos.y,
-		txt::Sequence{
-			&*node.cbegin() + m_view.index(),
-			unsigned_cast(max_ce(
-				txt::Cursor::difference_type{0},
-				signed_cast(node.units()) - m_view.index()
-			))
-		},
-		put_count,
+		view_seq,
+		unsigned_cast(inner_width),
 		content_fg,
 		content_bg
 	);
@@ -221,9 +250,13 @@ Field::render_impl(
 			frame.pos.x
 			+ min_ce(
 				inner_width,
-				1 + static_cast<geom_value_type>(
-					m_cursor.col() - m_view.col()
-				)
+				1 + static_cast<geom_value_type>(txt::sequence_width({
+					view_seq.data,
+					unsigned_cast(max_ce(
+						txt::Cursor::difference_type{0},
+						m_cursor.index() - m_view.index()
+					))
+				}))
 			),
 			frame.pos.y
 		);
@@ -28,7 +28,9 @@ Label::cache_geometry_impl() noexcept {
 	}
 
 	auto& rs = geometry().request_size();
-	rs.width = max_ce(1, 2 + static_cast<signed>(m_text.size()));
+	rs.width = max_ce(
+		1, 2 + static_cast<signed>(txt::sequence_width({m_text}))
+	);
 	rs.height = 1;
 }
 
@@ -59,8 +61,9 @@ Label::render_impl(
 	ui::Widget::RenderData& rd
 ) noexcept {
 	auto const& frame = geometry().frame();
+	auto const text_width = txt::sequence_width({m_text});
 	rd.terminal.put_sequence(
-		m_gc_pos.x + (signed_cast(m_text.size()) < frame.size.width),
+		m_gc_pos.x + (signed_cast(text_width) < frame.size.width),
 		m_gc_pos.y,
 		txt::Sequence{m_text, 0u, m_text.size()},
 		unsigned_cast(max_ce(0, frame.size.width)),
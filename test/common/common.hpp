@@ -89,23 +89,12 @@ load_term_info(
 	Beard::tty::TerminalInfo& term_info,
 	Beard::String const& path
 ) {
-	std::ifstream stream{path};
-	if (stream.fail() || !stream.is_open()) {
-		std::cerr
-			<< "failed to open terminfo path for reading: '"
-			<< path
-			<< "'\n"
-		;
-		return false;
-	}
-
 	try {
-		term_info.deserialize(stream);
-	} catch (...) {
-		// Just rethrow and let the program explode
-		throw;
+		term_info.load(path);
+	} catch (Beard::Error const& ex) {
+		report_error(ex);
+		return false;
 	}
-	stream.close();
 	return true;
 }
 
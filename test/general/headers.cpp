@@ -10,9 +10,14 @@
 #include <Beard/detail/gr_ceformat.hpp>
 #include <Beard/detail/debug.hpp>
 
+#include <Beard/txt/UTF8.hpp>
+
 #include <Beard/tty/Defs.hpp>
 #include <Beard/tty/Caps.hpp>
+#include <Beard/tty/Parm.hpp>
+#include <Beard/tty/Diff.hpp>
 #include <Beard/tty/TerminalInfo.hpp>
+#include <Beard/tty/TerminalInfoCache.hpp>
 #include <Beard/tty/Terminal.hpp>
 
 signed
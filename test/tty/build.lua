@@ -3,4 +3,7 @@ make_tests(
 	"tty", {
 	["info"] = {nil, nil},
 	["hello"] = {nil, nil},
+	["headless"] = {nil, nil},
+	["parm"] = {nil, nil},
+	["cache"] = {nil, nil},
 })
@@ -0,0 +1,89 @@
+// usage: cache terminfo-file-path
+// The path must be <dir>/<subdir>/<name>; <dir> is used as $TERMINFO.
+
+#include <Beard/config.hpp>
+#include <Beard/String.hpp>
+#include <Beard/tty/TerminalInfo.hpp>
+#include <Beard/tty/TerminalInfoCache.hpp>
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+
+using Beard::String;
+using Beard::tty::TerminalInfo;
+using Beard::tty::TerminalInfoCache;
+
+signed
+main(
+	signed argc,
+	char* argv[]
+) {
+	if (2 != argc) {
+		std::cerr <<
+			"invalid arguments\n"
+			"usage: cache terminfo-file-path\n"
+		;
+		return -1;
+	}
+
+	String const path{argv[1]};
+	auto const name_pos = path.rfind('/');
+	auto const subdir_pos
+		= (String::npos == name_pos || 0u == name_pos)
+		? String::npos
+		: path.rfind('/', name_pos - 1u)
+	;
+	if (String::npos == subdir_pos) {
+		std::cerr << "path must be <dir>/<subdir>/<name>\n";
+		return -2;
+	}
+	String const name = path.substr(name_pos + 1u);
+	::setenv("TERMINFO", path.substr(0u, subdir_pos).c_str(), 1);
+
+	String found{};
+	assert(TerminalInfoCache::locate(name, found));
+
+	// The first lookup loads the entry and later ones share it
+	TerminalInfoCache cache{};
+	auto const info = cache.find(name);
+	assert(info && info->is_initialized() && info->is_mapped());
+	assert(info == cache.find(name));
+	auto stats = cache.stats();
+	assert(1u == stats.hits && 1u == stats.misses && 1u == stats.size);
+
+	// Copies share the mapping
+	TerminalInfo const copy{*info};
+	assert(copy.is_mapped() && copy.names() == info->names());
+
+	// Names that aren't found or that would leave the directories
+	// aren't cached
+	char const* const invalid[]{
+		"", ".", "..", "../x", "x/../x", "beard-no-such-terminal"
+	};
+	for (auto const invalid_name : invalid) {
+		assert(!TerminalInfoCache::locate(invalid_name, found));
+		assert(!cache.find(invalid_name));
+	}
+	stats = cache.stats();
+	assert(1u == stats.hits && 7u == stats.misses && 1u == stats.size);
+
+	// $TERM
+	::setenv("TERM", name.c_str(), 1);
+	assert(info == cache.find_term());
+	::unsetenv("TERM");
+	assert(!cache.find_term());
+
+	// Clearing keeps shared entries alive
+	cache.clear();
+	assert(0u == cache.stats().size && info->is_initialized());
+	auto const reloaded = cache.find(name);
+	assert(reloaded && reloaded != info);
+	assert(reloaded->names() == info->names());
+
+	auto& process = TerminalInfoCache::process();
+	assert(&process == &TerminalInfoCache::process());
+	assert(process.find(name) == process.find(name));
+	assert(1u == process.stats().hits);
+	return 0;
+}
@@ -0,0 +1,335 @@
+// usage: headless terminfo-file-path
+
+#include <Beard/config.hpp>
+#include <Beard/String.hpp>
+#include <Beard/utility.hpp>
+#include <Beard/Error.hpp>
+#include <Beard/keys.hpp>
+#include <Beard/txt/Defs.hpp>
+#include <Beard/tty/Defs.hpp>
+#include <Beard/tty/Parm.hpp>
+#include <Beard/tty/TerminalInfo.hpp>
+#include <Beard/tty/Terminal.hpp>
+
+#include <cassert>
+#include <iostream>
+#include <iterator>
+
+#include "../common/common.hpp"
+
+using Beard::tty::make_cell;
+
+signed
+main(
+	signed argc,
+	char* argv[]
+) {
+	if (2 != argc) {
+		std::cerr <<
+			"invalid arguments\n"
+			"usage: headless terminfo-file-path\n"
+		;
+		return -1;
+	}
+
+	Beard::tty::Terminal term{};
+	if (!load_term_info(term.info(), argv[1])) {
+		return -2;
+	}
+	term.update_cache();
+
+	try {
+		term.open_headless({20, 4});
+	} catch (Beard::Error& ex) {
+		report_error(ex);
+		return -3;
+	}
+	assert(term.is_open() && term.is_headless());
+	assert(20 == term.width() && 4 == term.height());
+
+	// Output
+	term.clear_headless_output();
+	term.put_sequence(2, 1, {BEARD_STR_LIT("beard")}, 5u);
+	term.present();
+	assert(
+		Beard::String::npos != term.headless_output().find("beard")
+	);
+
+	// Nothing changed; only the caret is repositioned
+	term.clear_headless_output();
+	term.put_cell(2, 1, make_cell('b'));
+	term.present();
+	assert(
+		Beard::String::npos == term.headless_output().find('b')
+	);
+
+	// Short gaps are rewritten rather than repositioned
+	term.clear_headless_output();
+	term.put_cell(0, 2, make_cell('a'));
+	term.put_cell(2, 2, make_cell('c'));
+	term.present();
+	assert(
+		Beard::String::npos != term.headless_output().find("a c")
+	);
+
+	// Attribute changes are emitted as deltas with SGR caps
+	Beard::String bold_cap{};
+	Beard::String blink_cap{};
+	Beard::String smul_cap{};
+	Beard::String rev_cap{};
+	Beard::String sgr0_cap{};
+	term.info().cap_string(Beard::tty::CapString::enter_bold_mode, bold_cap);
+	term.info().cap_string(Beard::tty::CapString::enter_blink_mode, blink_cap);
+	term.info().cap_string(Beard::tty::CapString::enter_underline_mode, smul_cap);
+	term.info().cap_string(Beard::tty::CapString::enter_reverse_mode, rev_cap);
+	term.info().cap_string(Beard::tty::CapString::exit_attribute_mode, sgr0_cap);
+	term.clear_headless_output();
+	term.put_sequence(
+		0, 3, {BEARD_STR_LIT("ab")}, 2u,
+		Beard::tty::Color::red | Beard::tty::Attr::bold
+	);
+	term.put_sequence(
+		2, 3, {BEARD_STR_LIT("c")}, 1u,
+		Beard::tty::Color::red
+	);
+	term.present();
+	if (
+		0 == bold_cap.compare("\033[1m") &&
+		0 == blink_cap.compare("\033[5m") &&
+		0 == smul_cap.compare("\033[4m") &&
+		0 == rev_cap.compare("\033[7m") &&
+		(0 == sgr0_cap.compare("\033[m") || 0 == sgr0_cap.compare("\033[0m"))
+	) {
+		assert(
+			Beard::String::npos != term.headless_output().find("ab\033[22mc")
+		);
+	}
+
+	// Extended colors are reduced to what the terminal can display;
+	// basic colors are written with set_a_foreground if it exists
+	Beard::String red{"\033[31m"};
+	Beard::String setaf_cap{};
+	Beard::tty::ParmProgram setaf{};
+	if (
+		term.info().cap_string(Beard::tty::CapString::set_a_foreground, setaf_cap) &&
+		setaf.compile(setaf_cap)
+	) {
+		Beard::tty::ParmProgram::value_type const params[]{1};
+		red.resize(setaf.max_size());
+		red.resize(setaf.evaluate(&red[0u], params, 1u));
+	}
+	term.set_opt_max_colors(8u);
+	term.clear_headless_output();
+	term.put_cell(4, 3, make_cell('r', Beard::tty::make_color_rgb(0xFF, 0, 0)));
+	term.present();
+	assert(
+		Beard::String::npos != term.headless_output().find(red + 'r')
+	);
+	term.set_opt_max_colors(256u);
+	term.clear_headless_output();
+	term.put_cell(5, 3, make_cell('s', Beard::tty::make_color_index(196u)));
+	term.present();
+	assert(
+		Beard::String::npos != term.headless_output().find("\033[38;5;196ms")
+	);
+	term.set_opt_max_colors(0x1000000u);
+	term.clear_headless_output();
+	term.put_cell(6, 3, make_cell('t', Beard::tty::make_color_rgb(1, 2, 3)));
+	term.present();
+	assert(
+		Beard::String::npos != term.headless_output().find("\033[38;2;1;2;3mt")
+	);
+	term.set_opt_max_colors(0u);
+
+	// Scrolling shifts the screen rather than redrawing the rows
+	term.clear_headless_output();
+	bool const can_scroll = term.scroll_region({{0, 0}, {20, 4}}, 1);
+	if (can_scroll) {
+		term.present();
+		assert(
+			Beard::String::npos == term.headless_output().find("beard")
+		);
+	}
+	// Partial-width rects are only shifted in the back buffer
+	assert(!term.scroll_region({{0, 0}, {10, 4}}, -1));
+
+	// Rows that moved are detected and scrolled into place where
+	// scroll_region() could scroll them
+	char const* const lines[]{"zero", "one", "two", "three", "four"};
+	for (unsigned frame = 0u; 2u > frame; ++frame) {
+		term.clear_headless_output();
+		term.clear_back();
+		for (unsigned y = 0u; 4u > y; ++y) {
+			Beard::String const line{lines[frame + y]};
+			term.put_sequence(
+				0, static_cast<Beard::geom_value_type>(y),
+				{line}, line.size()
+			);
+		}
+		term.present();
+	}
+	assert(Beard::String::npos != term.headless_output().find("four"));
+	if (can_scroll) {
+		assert(Beard::String::npos == term.headless_output().find("two"));
+	}
+
+	// Uniform runs are erased or repeated
+	term.put_line({0, 0}, 20, Beard::Axis::x, make_cell('x'));
+	term.present();
+	term.clear_headless_output();
+	term.clear_back({{4, 0}, {16, 1}});
+	term.put_line({0, 1}, 12, Beard::Axis::x, make_cell('y'));
+	term.present();
+	Beard::String el_cap{};
+	Beard::String rep_cap{};
+	term.info().cap_string(Beard::tty::CapString::clr_eol, el_cap);
+	term.info().cap_string(Beard::tty::CapString::repeat_char, rep_cap);
+	if (0 == el_cap.compare("\033[K")) {
+		assert(
+			Beard::String::npos != term.headless_output().find("\033[K")
+		);
+	}
+	if (0 == rep_cap.compare("%p1%c\033[%p2%{1}%-%db")) {
+		assert(
+			Beard::String::npos != term.headless_output().find("y\033[11b")
+		);
+	}
+
+	// Erasing the end of a run doesn't move the cursor past it
+	term.put_line({0, 2}, 20, Beard::Axis::x, make_cell('w'));
+	term.present();
+	term.clear_headless_output();
+	term.clear_back({{0, 2}, {12, 1}});
+	term.present();
+	Beard::String ech_cap{};
+	term.info().cap_string(Beard::tty::CapString::erase_chars, ech_cap);
+	if (0 == ech_cap.compare("\033[%p1%dX")) {
+		auto const& output = term.headless_output();
+		auto const pos = output.find("\033[12X");
+		assert(Beard::String::npos != pos);
+		// Only the caret is positioned after the erase
+		auto const caret = output.find('\033', pos + 1u);
+		assert(
+			Beard::String::npos != caret &&
+			Beard::String::npos == output.find('\033', caret + 1u)
+		);
+	}
+
+	// Wide cells take two columns and split wide cells are blanked
+	term.clear_headless_output();
+	term.put_sequence(0, 2, {BEARD_STR_LIT("中文a")}, 5u);
+	term.put_sequence(0, 3, {BEARD_STR_LIT("e\xCC\x81")}, 1u);
+	term.present();
+	assert(
+		Beard::String::npos != term.headless_output().find("中文a") &&
+		Beard::String::npos != term.headless_output().find("e\xCC\x81")
+	);
+	term.clear_headless_output();
+	term.put_cell(1, 2, make_cell('x'));
+	term.present();
+	assert(
+		Beard::String::npos != term.headless_output().find(" x") &&
+		Beard::String::npos == term.headless_output().find("文")
+	);
+
+	// Invalid sequences are replaced
+	term.clear_headless_output();
+	term.put_sequence(0, 3, {BEARD_STR_LIT("a\xFF" "b")}, 3u);
+	term.present();
+	assert(
+		Beard::String::npos != term.headless_output().find("a\xEF\xBF\xBD" "b")
+	);
+
+	// Clusters longer than a cell's block are kept whole
+	Beard::String const clusters
+		= "\xE0\xB8\x81\xE0\xB8\xB5\xE0\xB9\x89"
+		  "e\xCC\x81\xCC\x82\xCC\x83"
+		  "中\xCC\x81\xCC\x82"
+	;
+	term.clear_headless_output();
+	term.put_sequence(0, 3, {clusters}, 4u);
+	term.present();
+	assert(Beard::String::npos != term.headless_output().find(clusters));
+	term.clear_headless_output();
+	term.put_sequence(0, 3, {clusters}, 4u);
+	term.present();
+	assert(Beard::String::npos == term.headless_output().find("\xE0\xB8\x81"));
+
+	// Clusters no cell refers to are dropped as others are stored;
+	// the clusters still shown stay the same
+	Beard::String wide_cluster{};
+	for (Beard::char32 cp = 0x4E00; 0x4E00 + 3000 > cp; ++cp) {
+		Beard::txt::EncUtils::char_type units[Beard::txt::EncUtils::max_units];
+		auto const end = Beard::txt::EncUtils::encode(
+			cp, std::begin(units), duct::CHAR_NULL
+		);
+		wide_cluster.assign(std::begin(units), end);
+		wide_cluster.append("\xCC\x81");
+		term.put_sequence(6, 3, {wide_cluster}, 2u);
+		term.present();
+	}
+	assert(Beard::String::npos != term.headless_output().find(wide_cluster));
+	term.clear_headless_output();
+	term.put_sequence(0, 3, {clusters}, 4u);
+	term.put_sequence(6, 3, {wide_cluster}, 2u);
+	term.present();
+	assert(Beard::String::npos == term.headless_output().find("\xCC\x81"));
+
+	// Input
+	Beard::tty::Event event{};
+	term.push_headless_input({BEARD_STR_LIT("x")});
+	assert(Beard::tty::EventType::key_input == term.poll(event, 0u));
+	assert('x' == event.key_input.cp);
+	assert(Beard::tty::EventType::none == term.poll(event, 0u));
+
+	// Synchronized output is probed and frames are only wrapped once
+	// the tty reports support; the report is not an event. Entries
+	// with a mode 2026 Sync cap aren't probed.
+	Beard::tty::CapStringValue sync_cap{};
+	bool const ext_sync
+		= term.info().lookup_ext_cap_string("Sync", sync_cap)
+		&& sync_cap.equals("\033[?2026%?%p1%{1}%-%tl%eh%;")
+	;
+	term.clear_headless_output();
+	term.set_opt_sync_output(true);
+	assert(
+		ext_sync ==
+		(Beard::String::npos == term.headless_output().find("\033[?2026$p"))
+	);
+	if (!ext_sync) {
+		term.clear_headless_output();
+		term.put_cell(0, 3, make_cell('s'));
+		term.present();
+		assert(
+			Beard::String::npos == term.headless_output().find("\033[?2026h")
+		);
+		term.push_headless_input({BEARD_STR_LIT("\033[?2026;2$yz")});
+		assert(Beard::tty::EventType::key_input == term.poll(event, 0u));
+		assert('z' == event.key_input.cp && Beard::KeyMod::none == event.key_input.mod);
+	}
+	term.clear_headless_output();
+	term.put_cell(1, 3, make_cell('t'));
+	term.present();
+	Beard::String const& sync_output = term.headless_output();
+	assert(0u == sync_output.find("\033[?2026h"));
+	assert(
+		sync_output.size() - 8u == sync_output.rfind("\033[?2026l")
+	);
+	term.set_opt_sync_output(false);
+
+	// Resize
+	term.set_headless_size({40, 10});
+	assert(Beard::tty::EventType::resize == term.poll(event, 0u));
+	assert(20 == event.resize.old_size.width);
+	assert(40 == term.width() && 10 == term.height());
+
+	// Setting the current size doesn't emit a resize event
+	term.set_headless_size({40, 10});
+	term.push_headless_input({BEARD_STR_LIT("y")});
+	assert(Beard::tty::EventType::key_input == term.poll(event, 0u));
+	assert('y' == event.key_input.cp);
+
+	term.close();
+	assert(!term.is_open() && !term.is_headless());
+	return 0;
+}
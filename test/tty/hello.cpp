@@ -55,7 +55,7 @@ render(
 	term.put_sequence(
 		4u, 4u,
 		{BEARD_STR_LIT("Hello, terminal overlord! 元気ですか？")},
-		32u
+		38u
 	);
 	term.present();
 }
@@ -6,6 +6,8 @@
 #include <Beard/tty/Caps.hpp>
 #include <Beard/tty/TerminalInfo.hpp>
 
+#include <cassert>
+#include <fstream>
 #include <iostream>
 #include <iomanip>
 
@@ -54,11 +56,11 @@ cout_string(
 	CapString const cap,
 	char const name[]
 ) {
-	TerminalInfo::cap_string_map_type::const_iterator it;
-	if (term_info.lookup_cap_string(cap, it)) {
+	Beard::tty::CapStringValue value{};
+	if (term_info.lookup_cap_string(cap, value)) {
 		std::cout
 			<< name
-			<< ": " << it->second
+			<< ": " << value.data
 			<< '\n'
 		;
 	}
@@ -101,6 +103,40 @@ main(
 		return -2;
 	}
 
+	// The mapped entry, a copy of it (sharing the mapping) and a
+	// deserialized entry agree
+	{
+		TerminalInfo const copy{term_info};
+		TerminalInfo streamed{};
+		std::ifstream stream{path};
+		streamed.deserialize(stream);
+		TerminalInfo const streamed_copy{streamed};
+		assert(term_info.is_mapped() && copy.is_mapped());
+		assert(!streamed.is_mapped() && !streamed_copy.is_mapped());
+		TerminalInfo const* const others[]{&copy, &streamed, &streamed_copy};
+		for (auto const* other : others) {
+			assert(other->names() == term_info.names());
+			assert(other->cap_flag_count() == term_info.cap_flag_count());
+			assert(other->cap_number_count() == term_info.cap_number_count());
+			assert(other->cap_string_count() == term_info.cap_string_count());
+			assert(other->ext_cap_count() == term_info.ext_cap_count());
+			for (unsigned cap = 0u; 512u > cap; ++cap) {
+				assert(
+					other->cap_number(static_cast<CapNumber>(cap)) ==
+					term_info.cap_number(static_cast<CapNumber>(cap))
+				);
+				Beard::tty::CapStringValue a{}, b{};
+				bool const found = term_info.lookup_cap_string(
+					static_cast<CapString>(cap), a
+				);
+				assert(found == other->lookup_cap_string(
+					static_cast<CapString>(cap), b
+				));
+				assert(!found || b.equals(a.data));
+			}
+		}
+	}
+
 	std::cout << "names (" << term_info.names().size() << "):\n";
 	for (auto const& name : term_info.names()) {
 		std::cout << "  '" << name << "'\n";
@@ -632,6 +668,28 @@ main(
 		BEARD_TEST_TTY_CAP_STRING__(box_chars_1);
 	}
 
+// extended
+	std::cout << '\n';
+	std::cout
+		<< "extended (" << term_info.ext_cap_count() << "):\n"
+	;
+	for (std::size_t index = 0u; term_info.ext_cap_count() > index; ++index) {
+		char const* const name = term_info.ext_cap_name(index);
+		assert(term_info.has_ext_cap(name));
+		Beard::tty::CapStringValue value{};
+		auto const number = term_info.ext_cap_number(name);
+		std::cout << name << ": ";
+		if (term_info.lookup_ext_cap_string(name, value)) {
+			std::cout << (print_strings ? value.data : "(string)");
+		} else if (Beard::tty::CAP_NUMBER_NOT_SUPPORTED != number) {
+			std::cout << number;
+		} else {
+			std::cout << term_info.ext_cap_flag(name);
+		}
+		std::cout << '\n';
+	}
+	assert(!term_info.has_ext_cap(""));
+
 //
 	return 0;
 }
@@ -0,0 +1,95 @@
+#include <Beard/config.hpp>
+#include <Beard/String.hpp>
+#include <Beard/utility.hpp>
+#include <Beard/tty/Parm.hpp>
+
+#include <cassert>
+#include <iostream>
+
+using namespace Beard;
+
+struct Case final {
+	char const* cap;
+	tty::ParmProgram::value_type params[3];
+	char const* expected;
+};
+
+static Case const
+s_cases[]{
+	// Plain text and delays
+	{"\033[H", {}, "\033[H"},
+	{"\033[C$<2>", {}, "\033[C"},
+	{"a$<x>b%%", {}, "a$<x>b%"},
+
+	// cursor_address and friends
+	{"\033[%i%p1%d;%p2%dH", {4, 9}, "\033[5;10H"},
+	{"\033[%i%p1%d;%p2%dH$<5>", {0, 0}, "\033[1;1H"},
+	{"\033[%p1%dC", {12}, "\033[12C"},
+	{"\033=%p1%' '%+%c%p2%' '%+%c", {2, 3}, "\033=\"#"},
+	{"%p1%c\033[%p2%{1}%-%db", {'x', 5}, "x\033[4b"},
+
+	// set_a_foreground (xterm-256color)
+	{
+		"\033[%?%p1%{8}%<%t3%p1%d%e%p1%{16}%<%t9%p1%{8}%-%d%e38;5;%p1%d%;m",
+		{3}, "\033[33m"
+	},
+	{
+		"\033[%?%p1%{8}%<%t3%p1%d%e%p1%{16}%<%t9%p1%{8}%-%d%e38;5;%p1%d%;m",
+		{12}, "\033[94m"
+	},
+	{
+		"\033[%?%p1%{8}%<%t3%p1%d%e%p1%{16}%<%t9%p1%{8}%-%d%e38;5;%p1%d%;m",
+		{196}, "\033[38;5;196m"
+	},
+
+	// Nested conditionals, and text after them
+	{"%?%p1%t%?%p2%tA%eB%;%eC%;D", {1, 1}, "AD"},
+	{"%?%p1%t%?%p2%tA%eB%;%eC%;D", {1, 0}, "BD"},
+	{"%?%p1%t%?%p2%tA%eB%;%eC%;D", {0, 1}, "CD"},
+	{"%?%p1%tA%;B", {0}, "B"},
+
+	// Arithmetic, logic and variables
+	{"%p1%p2%*%p3%/%d", {6, 7, 4}, "10"},
+	{"%p1%p2%m%d%p1%{0}%/%d", {7, 3}, "10"},
+	{"%p1%p2%&%d%p1%p2%|%d%p1%p2%^%d", {12, 10}, "8146"},
+	{"%p1%p2%>%d%p1%p2%<%d%p1%p2%=%d", {2, 1}, "100"},
+	{"%p1%p2%A%d%p1%p2%O%d%p1%!%d%p1%~%d", {0, 1}, "011-1"},
+	{"%p1%PA%p2%Pb%gb%gA%-%d", {3, 10}, "7"},
+	{"%{-5}%d%'A'%d", {}, "-565"},
+
+	// Formats
+	{"%p1%3d|%p1%:-3d|%p1%03d|%p1%.2d", {7}, "  7|7  |007|07"},
+	{"%p1%x|%p1%X|%p1%#x|%p1%o|%p1%#o", {255}, "ff|FF|0xff|377|0377"},
+	{"%p1%:+d|%p1% d|%p1%s", {5}, "+5| 5|5"},
+	{"%p1%d", {-12}, "-12"},
+};
+
+signed
+main() {
+	for (auto const& c : s_cases) {
+		tty::ParmProgram program{};
+		assert(program.compile(String{c.cap}));
+		assert(!program.empty());
+		char buffer[256];
+		assert(sizeof(buffer) >= program.max_size());
+		std::size_t const size = program.evaluate(buffer, c.params, 3u);
+		assert(size <= program.max_size());
+		if (0 != String{c.expected}.compare(0u, String::npos, buffer, size)) {
+			std::cerr
+				<< "mismatch for " << c.cap << ": "
+				<< String{buffer, size} << '\n'
+			;
+			return 1;
+		}
+	}
+
+	// Malformed strings leave the program empty
+	char const* const malformed[]{"%", "%p0", "%Pz%g!", "%{12", "%'a", "%t", "%q"};
+	for (auto const cap : malformed) {
+		tty::ParmProgram program{};
+		assert(!program.compile(String{cap}));
+		assert(program.empty() && 0u == program.max_size());
+	}
+	std::cout.flush();
+	return 0;
+}
@@ -2,4 +2,5 @@
 make_tests(
 	"txt", {
 	["ops"] = {nil, nil},
+	["utf8"] = {nil, nil},
 })
@@ -31,6 +31,7 @@ main() {
 	txt::Tree const t_1{String{"line 1"}};
 	txt::Tree const t_2{String{"line 1\nline 2"}};
 	txt::Tree const t_3{String{"line 1\nline 2\n"}};
+	txt::Tree const t_4{String{"caf\xC3\xA9\n\xE4\xB8\xAD\xE6\x96\x87"}};
 
 	assert(
 		1u == t_1.lines() &&
@@ -47,10 +48,16 @@ main() {
 		12u == t_3.units() &&
 		12u == t_3.points()
 	);
+	assert(
+		2u == t_4.lines() &&
+		11u == t_4.units() &&
+		6u == t_4.points()
+	);
 
 	print_tree("t_1", t_1);
 	print_tree("t_2", t_2);
 	print_tree("t_3", t_3);
+	print_tree("t_4", t_4);
 
 	std::cout.flush();
 	return 0;
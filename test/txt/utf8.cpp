@@ -0,0 +1,99 @@
+#include <Beard/config.hpp>
+#include <Beard/String.hpp>
+#include <Beard/utility.hpp>
+#include <Beard/txt/Defs.hpp>
+#include <Beard/txt/UTF8.hpp>
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+using namespace Beard;
+
+struct Case final {
+	char const* data;
+	// Size of the valid prefix
+	std::size_t valid;
+	// Number of code points
+	std::size_t points;
+};
+
+static Case const
+s_cases[]{
+	{"", 0u, 0u},
+	{"ascii only", 10u, 10u},
+	{"caf\xC3\xA9", 5u, 4u},
+	{"\xE4\xB8\xAD\xE6\x96\x87", 6u, 2u},
+	{"\xF0\x9F\x98\x80!", 5u, 2u},
+	// Stray continuation
+	{"ab\x80" "cd", 2u, 4u},
+	// Overlong
+	{"a\xC0\xAF", 1u, 2u},
+	{"a\xE0\x80\xAF", 1u, 2u},
+	{"a\xF0\x80\x80\xAF", 1u, 2u},
+	// Surrogate
+	{"a\xED\xA0\x80", 1u, 2u},
+	// Above U+10FFFF
+	{"a\xF4\x90\x80\x80", 1u, 2u},
+	{"a\xF5\x80\x80\x80", 1u, 2u},
+	// Incomplete
+	{"ab\xE4\xB8", 2u, 3u},
+	{"ab\xC3", 2u, 3u},
+	// Lead followed by ASCII
+	{"\xC3" "a", 0u, 2u},
+};
+
+// Check a kernel on case data at each offset into a long run of
+// ASCII, so that the vector paths cross block edges
+static void
+check(
+	txt::UTF8Kernel const& kernel,
+	Case const& c
+) {
+	std::size_t const size = std::strlen(c.data);
+	for (std::size_t offset = 0u; 70u > offset; ++offset) {
+		String str(offset, 'x');
+		str.append(c.data, size);
+		str.append(offset % 3u, 'y');
+		bool const valid = c.valid == size;
+		std::size_t const expected_valid
+			= offset + c.valid + (valid ? offset % 3u : 0u);
+		assert(expected_valid == kernel.valid_prefix(str.data(), str.size()));
+		assert(
+			offset + c.points + offset % 3u
+			== kernel.count_points(str.data(), str.size())
+		);
+		std::size_t ascii = 0u;
+		for (; size > ascii && 0x80u > static_cast<unsigned char>(c.data[ascii]); ++ascii) {}
+		assert(
+			offset + ascii + (size == ascii ? offset % 3u : 0u)
+			== kernel.ascii_prefix(str.data(), str.size())
+		);
+	}
+}
+
+signed
+main() {
+	for (unsigned impl = 0u; enum_cast(txt::UTF8Impl::COUNT) > impl; ++impl) {
+		auto const kind = static_cast<txt::UTF8Impl>(impl);
+		if (!txt::utf8_supported(kind)) {
+			continue;
+		}
+		auto const& kernel = txt::utf8_kernel(kind);
+		std::cout << "checking " << kernel.name << '\n';
+		for (auto const& c : s_cases) {
+			check(kernel, c);
+		}
+	}
+
+	// Columns, as put by tty::Terminal::put_sequence()
+	assert(0u == txt::sequence_width({""}));
+	assert(5u == txt::sequence_width({"caf\xC3\xA9!"}));
+	assert(5u == txt::sequence_width({"\xE4\xB8\xAD\xE6\x96\x87" "a"}));
+	assert(1u == txt::sequence_width({"e\xCC\x81"}));
+	assert(0u == txt::sequence_width({"\xCC\x81"}));
+	assert(4u == txt::sequence_width({"ab\x80" "c"}));
+	assert(3u == txt::sequence_width({"ab\xE4\xB8"}));
+	std::cout.flush();
+	return 0;
+}
@@ -1,6 +1,7 @@
 
 make_tests(
 	"ui", {
+	["field"] = {nil, nil},
 	["grid"] = {nil, nil},
 	["packing"] = {nil, nil},
 	["dynamic_focus"] = {nil, nil},
@@ -0,0 +1,71 @@
+// usage: field terminfo-file-path
+
+#include <Beard/utility.hpp>
+#include <Beard/Error.hpp>
+#include <Beard/geometry.hpp>
+#include <Beard/tty/Terminal.hpp>
+#include <Beard/ui/Context.hpp>
+#include <Beard/ui/Root.hpp>
+#include <Beard/ui/Field.hpp>
+
+#include <cassert>
+#include <iostream>
+
+#include "../common/common.hpp"
+
+using namespace Beard;
+
+signed
+main(
+	signed argc,
+	char* argv[]
+) {
+	if (2 != argc) {
+		std::cerr <<
+			"invalid arguments\n"
+			"usage: field terminfo-file-path\n"
+		;
+		return -1;
+	}
+
+	ui::Context ctx;
+	tty::Terminal& term = ctx.terminal();
+	if (!load_term_info(term.info(), argv[1])) {
+		return -2;
+	}
+	term.update_cache();
+
+	try {
+		term.open_headless({12, 1});
+	} catch (Error const& ex) {
+		report_error(ex);
+		return -3;
+	}
+
+	auto root = ui::Root::make(ctx, Axis::vertical);
+	ctx.set_root(root);
+	auto field = ui::Field::make(root, "一二三四五六七八");
+	field->geometry().set_sizing(Axis::both, Axis::both);
+	root->push_back(field);
+	ctx.render(true);
+	assert(12 == field->geometry().frame().size.width);
+
+	// Wide text longer than the field is scrolled by columns so that
+	// the cursor at its end is shown
+	term.clear_headless_output();
+	field->set_input_control(true);
+	ctx.render(false);
+	auto const& output = term.headless_output();
+	assert(String::npos != output.find("七八"));
+	assert(String::npos == output.find("一"));
+
+	// Without input control the head is shown
+	term.clear_headless_output();
+	field->set_input_control(false);
+	ctx.render(false);
+	assert(String::npos != output.find("一二"));
+	assert(String::npos == output.find("八"));
+
+	ctx.close();
+	return 0;
+}